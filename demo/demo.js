@@ -282,15 +282,6 @@ function process_frame(ctx) {
 
 const renderer = new Canvas2DRenderer({ canvas });
 
-function draw() {
-    process_frame(renderer.microui_context());
-
-    renderer.canvas2d_context().fillStyle = get_bg_color_str();
-    renderer.canvas2d_context().fillRect(0, 0, canvas.width, canvas.height);
-
-    renderer.render();
-
-    window.requestAnimationFrame(draw);
-}
-
-window.requestAnimationFrame(draw);
+// frames only run after input or while the ui settles, and the canvas is only
+// repainted where the frame changed
+renderer.start(process_frame, get_bg_color_str);
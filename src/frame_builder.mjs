@@ -0,0 +1,305 @@
+// Encodes frames for `run_frame`. Like `replay.mjs` it only touches the WASM
+// module through the context and module it is given, so it can be tested
+// under Node.
+
+// mirror frame_program.h
+export const op = {
+    LAYOUT_ROW: 0,
+    BEGIN_COLUMN: 1,
+    END_COLUMN: 2,
+    PUSH_ID: 3,
+    PUSH_ID_HASHED: 4,
+    POP_ID: 5,
+    TEXT: 6,
+    LABEL: 7,
+    BUTTON: 8,
+    CHECKBOX: 9,
+    TEXTBOX: 10,
+    SLIDER: 11,
+    NUMBER: 12,
+    HEADER: 13,
+    BEGIN_TREENODE: 14,
+    END_TREENODE: 15,
+    BEGIN_WINDOW: 16,
+    END_WINDOW: 17,
+    OPEN_POPUP: 18,
+    BEGIN_POPUP: 19,
+    END_POPUP: 20,
+    BEGIN_PANEL: 21,
+    END_PANEL: 22,
+};
+
+// mirrors MU_OPT_ALIGNCENTER
+const OPT_ALIGNCENTER = 1;
+
+// the WASM side buffers of `run_frame` of each module, shared by its builders
+const run_frame_buffers = new WeakMap();
+
+/**
+ * Encodes a frame's widget calls as ops (see `wasm-src/frame_program.h`) and
+ * runs them with one `run_frame` call, between `begin()` and `end()`. Labels
+ * are strings or `intern` handles. Widgets return a result slot, read with
+ * `result(slot)` after `run()`, so a frame acts on the results of the one
+ * before. A builder that isn't `reset()` runs the same frame again.
+ */
+export class FrameBuilder {
+    /**
+     * @param mctx a `Context`
+     * @param module the WASM module `mctx` comes from, for its `HEAP32`
+     */
+    constructor(mctx, module) {
+        this.mctx = mctx;
+        this.module = module;
+        this.code = new Int32Array(256);
+        this.floats = new Float32Array(this.code.buffer);
+        this.len = 0;
+        this.slots = 0;
+        this.results = new Int32Array(16);
+        // pairs of the open block's op and the index of its skip word
+        this.blocks = [];
+        this.handles = new Map();
+    }
+
+    reset() {
+        this.len = 0;
+        this.slots = 0;
+        this.blocks.length = 0;
+    }
+
+    /** @returns {number} 0 after running the frame, -1 if it was rejected */
+    run() {
+        if (this.blocks.length !== 0)
+            throw new Error("FrameBuilder: a header, treenode, window or popup is not closed");
+        const mctx = this.mctx, module = this.module;
+        let buffers = run_frame_buffers.get(module);
+        if (buffers === undefined) {
+            buffers = { code: 0, code_words: 0, results: 0, result_count: 0 };
+            run_frame_buffers.set(module, buffers);
+        }
+        if (this.len > buffers.code_words) {
+            buffers.code_words = Math.max(this.len, buffers.code_words * 2);
+            buffers.code = mctx.frame_code_reserve(buffers.code_words);
+        }
+        if (this.slots > buffers.result_count) {
+            buffers.result_count = Math.max(this.slots, buffers.result_count * 2);
+            buffers.results = mctx.frame_results_reserve(buffers.result_count);
+        }
+        module.HEAP32.set(this.code.subarray(0, this.len), buffers.code >> 2);
+        const res = mctx.run_frame(buffers.code, this.len);
+        if (this.results.length < this.slots)
+            this.results = new Int32Array(buffers.result_count);
+        const first = buffers.results >> 2;
+        this.results.set(module.HEAP32.subarray(first, first + this.slots));
+        return res;
+    }
+
+    /** @returns {number} the `RES_*` bits of the widget at `slot` in the last run */
+    result(slot) {
+        return this.results[slot];
+    }
+
+    handle(label) {
+        if (typeof label === "number")
+            return label;
+        let h = this.handles.get(label);
+        if (h === undefined) {
+            h = this.mctx.intern(label);
+            this.handles.set(label, h);
+        }
+        return h;
+    }
+
+    // appends an op of `words` words, returns the index of its first word
+    op(code, words) {
+        if (this.len + words > this.code.length) {
+            const grown = new Int32Array(Math.max(this.code.length * 2, this.len + words));
+            grown.set(this.code.subarray(0, this.len));
+            this.code = grown;
+            this.floats = new Float32Array(grown.buffer);
+        }
+        const i = this.len;
+        this.code[i] = code;
+        this.len += words;
+        return i;
+    }
+
+    slot() {
+        return this.slots++;
+    }
+
+    begin_block(code, skip) {
+        this.blocks.push(code, skip);
+    }
+
+    end_block(code) {
+        const skip = this.blocks.pop(), begun = this.blocks.pop();
+        if (begun !== code)
+            throw new Error("FrameBuilder: mismatched end of block");
+        this.code[skip] = this.len - skip - 1;
+    }
+
+    layout_row(widths, height) {
+        const i = this.op(op.LAYOUT_ROW, 3 + widths.length);
+        this.code[i + 1] = widths.length;
+        this.code[i + 2] = height;
+        this.code.set(widths, i + 3);
+    }
+
+    layout_begin_column() {
+        this.op(op.BEGIN_COLUMN, 1);
+    }
+
+    layout_end_column() {
+        this.op(op.END_COLUMN, 1);
+    }
+
+    // `value` is an int32, e.g. an address as given to `push_id_ptr`
+    push_id(value) {
+        const i = this.op(op.PUSH_ID, 2);
+        this.code[i + 1] = value;
+    }
+
+    push_id_label(label) {
+        const i = this.op(op.PUSH_ID_HASHED, 2);
+        this.code[i + 1] = this.handle(label);
+    }
+
+    pop_id() {
+        this.op(op.POP_ID, 1);
+    }
+
+    text(str) {
+        const i = this.op(op.TEXT, 2);
+        this.code[i + 1] = this.handle(str);
+    }
+
+    label(label) {
+        const i = this.op(op.LABEL, 2);
+        this.code[i + 1] = this.handle(label);
+    }
+
+    // `label` may be null for an icon only button
+    button(label, icon = 0, opt = OPT_ALIGNCENTER) {
+        const i = this.op(op.BUTTON, 5);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = label === null ? -1 : this.handle(label);
+        this.code[i + 3] = icon;
+        this.code[i + 4] = opt;
+        return slot;
+    }
+
+    // `state` is the address of an int
+    checkbox(label, state) {
+        const i = this.op(op.CHECKBOX, 4);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = this.handle(label);
+        this.code[i + 3] = state;
+        return slot;
+    }
+
+    textbox(buf, bufsz, opt = 0) {
+        const i = this.op(op.TEXTBOX, 5);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = buf;
+        this.code[i + 3] = bufsz;
+        this.code[i + 4] = opt;
+        return slot;
+    }
+
+    // `value` is the address of a float, `fmt` null for the default
+    slider(value, low, high, step = 0, fmt = null, opt = OPT_ALIGNCENTER) {
+        const i = this.op(op.SLIDER, 8);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = value;
+        this.floats[i + 3] = low;
+        this.floats[i + 4] = high;
+        this.floats[i + 5] = step;
+        this.code[i + 6] = fmt === null ? -1 : this.handle(fmt);
+        this.code[i + 7] = opt;
+        return slot;
+    }
+
+    number(value, step, fmt = null, opt = OPT_ALIGNCENTER) {
+        const i = this.op(op.NUMBER, 6);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = value;
+        this.floats[i + 3] = step;
+        this.code[i + 4] = fmt === null ? -1 : this.handle(fmt);
+        this.code[i + 5] = opt;
+        return slot;
+    }
+
+    // the ops up to `end_header()` only run while the header is expanded
+    header(label, opt = 0) {
+        const i = this.op(op.HEADER, 5);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = this.handle(label);
+        this.code[i + 3] = opt;
+        this.begin_block(op.HEADER, i + 4);
+        return slot;
+    }
+
+    end_header() {
+        this.end_block(op.HEADER);
+    }
+
+    begin_treenode(label, opt = 0) {
+        const i = this.op(op.BEGIN_TREENODE, 5);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = this.handle(label);
+        this.code[i + 3] = opt;
+        this.begin_block(op.BEGIN_TREENODE, i + 4);
+        return slot;
+    }
+
+    end_treenode() {
+        this.op(op.END_TREENODE, 1);
+        this.end_block(op.BEGIN_TREENODE);
+    }
+
+    begin_window(title, x, y, w, h, opt = 0) {
+        const i = this.op(op.BEGIN_WINDOW, 9);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = this.handle(title);
+        this.code[i + 3] = x;
+        this.code[i + 4] = y;
+        this.code[i + 5] = w;
+        this.code[i + 6] = h;
+        this.code[i + 7] = opt;
+        this.begin_block(op.BEGIN_WINDOW, i + 8);
+        return slot;
+    }
+
+    end_window() {
+        this.op(op.END_WINDOW, 1);
+        this.end_block(op.BEGIN_WINDOW);
+    }
+
+    open_popup(name) {
+        const i = this.op(op.OPEN_POPUP, 2);
+        this.code[i + 1] = this.handle(name);
+    }
+
+    begin_popup(name) {
+        const i = this.op(op.BEGIN_POPUP, 4);
+        const slot = this.code[i + 1] = this.slot();
+        this.code[i + 2] = this.handle(name);
+        this.begin_block(op.BEGIN_POPUP, i + 3);
+        return slot;
+    }
+
+    end_popup() {
+        this.op(op.END_POPUP, 1);
+        this.end_block(op.BEGIN_POPUP);
+    }
+
+    begin_panel(name, opt = 0) {
+        const i = this.op(op.BEGIN_PANEL, 3);
+        this.code[i + 1] = this.handle(name);
+        this.code[i + 2] = opt;
+    }
+
+    end_panel() {
+        this.op(op.END_PANEL, 1);
+    }
+}
@@ -1,4 +1,7 @@
-const enable_debug = false;
+import { FrameBuilder as ModuleFrameBuilder } from "./frame_builder.mjs";
+import { FONT_HEIGHT, FramePainter, copy_frame } from "./replay.mjs";
+
+export { FramePainter, SharedFrameReader, copy_frame } from "./replay.mjs";
 
 /**
  * @param {CanvasRenderingContext2D} ctx2d
@@ -11,56 +14,93 @@ function getMetrics(ctx2d, text, len) {
     ctx2d.font = `${FONT_HEIGHT}px sans`;
     let str;
     if (typeof text === "string")
-        str = text;
+        str = len === -1 ? text : text.substring(0, len);
     else
-        str = microui.UTF8ToString(text);
-    if (len !== -1)
-        str = str.substring(0, len);
+        // `len` counts UTF-8 bytes
+        str = len === -1 ? microui.UTF8ToString(text) : microui.UTF8ToString(text, len);
     const metrics = ctx2d.measureText(str);
     ctx2d.restore();
     return metrics;
 }
 
-const FONT_HEIGHT = 12;
-
 export class Canvas2DRenderer {
-    // canvas, canvas2d_context, microui_context, key_event_target
+    // canvas, canvas2d_context, microui_context, capacity, key_event_target, worker, optimize
+    // `capacity` sizes a new microui context, e.g. `{ command_bytes: 4096, container_pool: 4 }`
+    // `worker` (`true` or a Worker running `render_worker.mjs`) moves painting
+    // off the main thread, the canvas is transferred to it
+    // `optimize` runs `optimize_commands()` on each frame before painting it
     constructor(options) {
         const canvas = options.canvas;
 
         let ctx2d;
-        if (options.canvas2d_context !== undefined) {
+        this.worker = null;
+        if (options.worker !== undefined) {
+            this.worker = options.worker === true ?
+                new Worker(new URL("./render_worker.mjs", import.meta.url), { type: "module" }) : options.worker;
+            const offscreen = canvas.transferControlToOffscreen();
+            this.worker.postMessage({ type: "init", canvas: offscreen, scale: window.devicePixelRatio }, [offscreen]);
+            // text is still measured here, on a context of its own
+            ctx2d = new OffscreenCanvas(1, 1).getContext("2d");
+        } else if (options.canvas2d_context !== undefined) {
             ctx2d = options.canvas2d_context;
         } else {
             ctx2d = canvas.getContext("2d");
             ctx2d.scale(window.devicePixelRatio, window.devicePixelRatio);
         }
         this.ctx2d = ctx2d;
+        this.optimize = options.optimize === true;
+        // what is on the canvas, see `render`
+        this.painter = this.worker === null ? new FramePainter(ctx2d) : null;
+        // the last frame sent to the worker
+        this.posted_hash = undefined;
+        this.posted_background = undefined;
+        // on demand frames, see `start`
+        this.frame_callback = null;
+        this.frame_background = undefined;
+        this.frame_requested = false;
+        this.keep_alive_until = 0;
+        this.raf_handle = 0;
 
         let mctx;
         if (options.microui_context !== undefined) {
             mctx = options.microui_context;
         } else {
-            mctx = new microui.Context();
+            mctx = options.capacity !== undefined ? new microui.Context(options.capacity) : new microui.Context();
             const metrics = getMetrics(ctx2d, "ABC", -1);
             const font_height_actual = metrics.fontBoundingBoxAscent + metrics.fontBoundingBoxDescent;
             mctx.set_text_width_callback(microui.addFunction((_, text, len) => getMetrics(ctx2d, text, len).width, 'iiii'));
             mctx.set_text_height_callback(microui.addFunction((_) => font_height_actual, 'ii'));
+            // glyph advances are cached in WASM, so the callbacks above only
+            // run for glyphs that were not measured yet
+            mctx.enable_text_width_cache();
         }
         this.mctx = mctx;
+        // without a context (`microui_context: null`) the renderer only paints
+        // frames passed to `paint`, e.g. from a `SharedFrameReader`
+        if (mctx === null)
+            return;
+
+        // events are written into the context's input queue without calling
+        // into WASM, `begin()` applies the whole batch
+        const queue = new InputQueue(mctx);
+        this.input_queue = queue;
 
         const mu_mouse_btns = [microui.MOUSE_LEFT, microui.MOUSE_MIDDLE, microui.MOUSE_RIGHT];
         canvas.addEventListener("mousemove", ev => {
-            mctx.input_mousemove(ev.offsetX, ev.offsetY);
+            queue.push(microui.INPUT_MOUSEMOVE, ev.offsetX, ev.offsetY, 0);
+            this.schedule_frame();
         });
         canvas.addEventListener("mousedown", ev => {
-            mctx.input_mousedown(ev.offsetX, ev.offsetY, mu_mouse_btns[ev.button]);
+            queue.push(microui.INPUT_MOUSEDOWN, ev.offsetX, ev.offsetY, mu_mouse_btns[ev.button]);
+            this.schedule_frame();
         });
         canvas.addEventListener("mouseup", ev => {
-            mctx.input_mouseup(ev.offsetX, ev.offsetY, mu_mouse_btns[ev.button]);
+            queue.push(microui.INPUT_MOUSEUP, ev.offsetX, ev.offsetY, mu_mouse_btns[ev.button]);
+            this.schedule_frame();
         });
         canvas.addEventListener("wheel", ev => {
-            mctx.input_scroll(ev.deltaX, ev.deltaY);
+            queue.push(microui.INPUT_SCROLL, ev.deltaX, ev.deltaY, 0);
+            this.schedule_frame();
         });
 
         let key_event_target;
@@ -73,16 +113,26 @@ export class Canvas2DRenderer {
         key_event_target.addEventListener("keydown", ev => {
             const ck = map_control_key(ev.key);
             if (ck) {
-                mctx.input_keydown(ck);
-            } else if (ev.key.length == 1) {
-                mctx.input_text(ev.key);
+                queue.push(microui.INPUT_KEYDOWN, ck, 0, 0);
+            } else if (ev.key.length == 1 && !ev.ctrlKey && !ev.metaKey) {
+                // shortcuts like ctrl+c aren't typed text
+                queue.push_text(ev.key);
             }
+            this.schedule_frame();
+        });
+        // a paste is encoded straight into WASM memory in one go, or queued
+        // behind the text typed before it
+        key_event_target.addEventListener("paste", ev => {
+            const text = ev.clipboardData.getData("text");
+            if (text.length > 0 && paste_text(mctx, text, queue))
+                this.schedule_frame();
         });
         key_event_target.addEventListener("keyup", ev => {
             const ck = map_control_key(ev.key);
             if (ck) {
-                mctx.input_keyup(ck);
+                queue.push(microui.INPUT_KEYUP, ck, 0, 0);
             }
+            this.schedule_frame();
         });
     }
 
@@ -94,164 +144,531 @@ export class Canvas2DRenderer {
         return this.ctx2d;
     }
 
-    render() {
-        process_commands(this.mctx, this.ctx2d);
+    /**
+     * Paints the frame built by the last `end()`. When the command stream
+     * hashes the same as the one already on the canvas (and the background
+     * is unchanged) nothing is cleared or replayed. When the canvas holds the
+     * previous frame, only the damaged rects reported by the core are cleared
+     * and only the commands touching them are replayed. With a worker the
+     * frame is copied and sent to it instead.
+     * @param {string} [background] CSS color the canvas is cleared with first;
+     *     without it every changed frame is replayed over the whole canvas
+     * @returns {boolean} whether the canvas was repainted (or a frame sent)
+     */
+    render(background) {
+        const dropped = this.mctx.command_list_overflow();
+        if (dropped > 0 && !this.overflow_warned) {
+            console.warn(`microui: command list limit reached, ${dropped} commands were dropped`);
+            this.overflow_warned = true;
+        }
+        if (this.worker !== null)
+            return this.post_frame(background);
+        const painter = this.painter;
+        if (this.mctx.frame_hash === painter.painted_hash && background === painter.painted_background)
+            return false;
+        return painter.paint(local_frame(this.mctx, this.optimize), background);
     }
-}
 
-let CONTROL_KEY_MAP;
-function map_control_key(k) {
-    if (CONTROL_KEY_MAP === undefined) {
-        CONTROL_KEY_MAP = new Map([
-            ["Shift", microui.KEY_SHIFT],
-            ["Control", microui.KEY_CTRL],
-            ["Alt", microui.KEY_ALT],
-            ["Enter", microui.KEY_RETURN],
-            ["Backspace", microui.KEY_BACKSPACE],
-        ]);
+    /**
+     * Like `render`, for a frame that was packed elsewhere, e.g. by a
+     * `SharedFrameReader`. Not available with a worker.
+     * @param {PackedFrame} frame
+     * @param {string} [background]
+     * @returns {boolean} whether the canvas was repainted
+     */
+    paint(frame, background) {
+        return this.painter.paint(frame, background);
+    }
+
+    post_frame(background) {
+        if (this.mctx.frame_hash === this.posted_hash && background === this.posted_background)
+            return false;
+        this.posted_hash = this.mctx.frame_hash;
+        this.posted_background = background;
+        const frame = copy_frame(local_frame(this.mctx, this.optimize));
+        this.worker.postMessage({ type: "frame", frame, background }, [frame.buffer]);
+        return true;
+    }
+
+    /**
+     * Forces the next `render` to repaint, e.g. after the canvas was resized
+     * or drawn over by someone else.
+     */
+    invalidate() {
+        if (this.worker !== null) {
+            this.posted_hash = undefined;
+            this.worker.postMessage({ type: "invalidate" });
+        } else {
+            this.painter.invalidate();
+        }
+        this.request_frame();
+    }
+
+    /**
+     * Runs frames on demand instead of on every animation frame: `frame(mctx)`
+     * (which calls `begin` and `end`) runs and is rendered only after input,
+     * while the UI is still settling, after `request_frame()` and during a
+     * `keep_alive()` period. An idle UI schedules no callbacks at all.
+     * @param {(mctx) => void} frame
+     * @param {string | (() => string)} [background] passed on to `render`
+     */
+    start(frame, background) {
+        this.frame_callback = frame;
+        this.frame_background = background;
+        this.request_frame();
+    }
+
+    stop() {
+        this.frame_callback = null;
+        if (this.raf_handle !== 0)
+            cancelAnimationFrame(this.raf_handle);
+        this.raf_handle = 0;
+    }
+
+    /**
+     * Asks for one more frame, for application state the UI shows that
+     * changed outside of input handling (timers, network, ...).
+     */
+    request_frame() {
+        this.frame_requested = true;
+        this.schedule_frame();
+    }
+
+    /**
+     * Keeps running frames for the next `ms` milliseconds, for animations.
+     * @param {number} ms
+     */
+    keep_alive(ms) {
+        this.keep_alive_until = Math.max(this.keep_alive_until, performance.now() + ms);
+        this.schedule_frame();
+    }
+
+    schedule_frame() {
+        if (this.frame_callback !== null && this.raf_handle === 0)
+            this.raf_handle = requestAnimationFrame(now => this.run_frame(now));
+    }
+
+    run_frame(now) {
+        this.raf_handle = 0;
+        if (this.frame_callback === null)
+            return;
+        this.frame_requested = false;
+        this.frame_callback(this.mctx);
+        const bg = this.frame_background;
+        this.render(typeof bg === "function" ? bg() : bg);
+        // the core reports whether the next frame could still differ
+        if (this.frame_requested || this.mctx.needs_frame() || now < this.keep_alive_until)
+            this.schedule_frame();
     }
-    return CONTROL_KEY_MAP.get(k);
 }
 
 /**
- * @param {*} mctx
- * @param {CanvasRenderingContext2D} ctx2d
+ * Writes input records straight into a context's input queue in WASM memory
+ * (see `mu_InputQueue`), so a DOM event costs no call into WASM. Runs of moves
+ * and scrolls are folded into one record like `mu_queue_input` does.
  */
-function process_commands(mctx, ctx2d) {
-    ctx2d.save();
+export class InputQueue {
+    constructor(mctx) {
+        this.header = mctx.input_queue_addr() >> 2;
+        this.records = mctx.input_records_addr() >> 2;
+    }
 
-    const commands = mctx.commands();
-    for (const cmd of commands) {
-        switch (cmd.type) {
-            case microui.COMMAND_TEXT: draw_text(ctx2d, cmd.text_str, cmd.text.pos, cmd.text.color); break;
-            case microui.COMMAND_RECT: draw_rect(ctx2d, cmd.rect.rect, cmd.rect.color); break;
-            case microui.COMMAND_ICON: draw_icon(ctx2d, cmd.icon.id, cmd.icon.rect, cmd.icon.color); break;
-            case microui.COMMAND_CLIP: set_clip_rect(ctx2d, cmd.clip.rect); break;
+    /**
+     * @returns {boolean} false if the queue was full and the event dropped
+     */
+    push(type, a, b, c) {
+        // growing the memory replaces the views, so don't keep them around
+        const heap = microui.HEAP32;
+        const h = this.header;
+        const head = heap[h], tail = heap[h + 1], mask = heap[h + 2];
+        if (head !== tail && (type === microui.INPUT_MOUSEMOVE || type === microui.INPUT_SCROLL)) {
+            const last = this.records + ((head - 1) & mask) * microui.INPUT_WORDS;
+            if (heap[last] === type) {
+                if (type === microui.INPUT_MOUSEMOVE) {
+                    heap[last + 1] = a;
+                    heap[last + 2] = b;
+                } else {
+                    heap[last + 1] += a;
+                    heap[last + 2] += b;
+                }
+                return true;
+            }
         }
+        const rec = this.reserve();
+        if (rec < 0)
+            return false;
+        heap[rec] = type;
+        heap[rec + 1] = a;
+        heap[rec + 2] = b;
+        heap[rec + 3] = c;
+        this.commit();
+        return true;
     }
 
-    ctx2d.restore();
+    /**
+     * @param {string} str
+     * @returns {boolean} false if the queue filled up before all of `str` was queued
+     */
+    push_text(str) {
+        while (str.length > 0) {
+            const rec = this.reserve();
+            if (rec < 0)
+                return false;
+            // each record holds up to 8 bytes of whole utf-8 characters
+            const bytes = microui.HEAPU8.subarray((rec + 2) * 4, (rec + 4) * 4);
+            const { read, written } = text_encoder.encodeInto(str, bytes);
+            if (written === 0)
+                return false;
+            microui.HEAP32[rec] = microui.INPUT_TEXT;
+            microui.HEAP32[rec + 1] = written;
+            this.commit();
+            str = str.substring(read);
+        }
+        return true;
+    }
+
+    /** @returns {boolean} whether there are records `begin()` hasn't applied yet */
+    pending() {
+        const heap = microui.HEAP32;
+        return heap[this.header] !== heap[this.header + 1];
+    }
+
+    // index into HEAP32 of the record at `head`, or -1 when full
+    reserve() {
+        const heap = microui.HEAP32;
+        const h = this.header;
+        const head = heap[h];
+        if (((head + 1) & heap[h + 2]) === heap[h + 1]) {
+            heap[h + 3]++;
+            return -1;
+        }
+        return this.records + head * microui.INPUT_WORDS;
+    }
+
+    commit() {
+        const heap = microui.HEAP32;
+        const h = this.header;
+        heap[h] = (heap[h] + 1) & heap[h + 2];
+    }
+}
+
+const text_encoder = new TextEncoder();
+
+/** @typedef {import("./replay.mjs").PackedFrame} PackedFrame */
+
+// packs the frame built by the last `end()` of `mctx` in place
+function local_frame(mctx, optimize) {
+    let count = mctx.pack_commands();
+    if (optimize)
+        count = mctx.optimize_commands();
+    return {
+        buffer: microui.HEAP32.buffer,
+        count,
+        records: mctx.packed_commands_addr(),
+        text: mctx.packed_text_addr(),
+        text_generation: mctx.packed_text_generation(),
+        hash: mctx.frame_hash,
+        damage_base: mctx.damage_base(),
+        damage: mctx.damage_rects_addr(),
+        damage_count: mctx.damage_count(),
+    };
 }
 
 /**
- * @param {CanvasRenderingContext2D} ctx2d
+ * Appends `str` to the text input of the current frame without going through
+ * an embind string or the input queue. Text in the queue is only applied by
+ * `begin()`, so while `queue` has records pending `str` is queued after them
+ * instead, to keep what was typed before the paste in front of it.
+ * @param {InputQueue} [queue] the queue of `mctx`, if events go through one
+ * @returns {boolean} false if the text went past the core's input text limit
+ * or didn't fit in the queue
  */
-function draw_text(ctx2d, str, pos, color) {
+export function paste_text(mctx, str, queue = null) {
+    if (queue !== null && queue.pending())
+        return queue.push_text(str);
+    // utf-16 code units never take more than 3 utf-8 bytes
+    const max = str.length * 3;
+    const ptr = mctx.input_text_reserve(max);
+    if (ptr === 0) {
+        // the worst case doesn't fit, try the exact size
+        const bytes = text_encoder.encode(str);
+        const exact = mctx.input_text_reserve(bytes.length);
+        if (exact === 0)
+            return false;
+        microui.HEAPU8.set(bytes, exact);
+        mctx.input_text_commit(bytes.length);
+        return true;
+    }
+    const { written } = text_encoder.encodeInto(str, microui.HEAPU8.subarray(ptr, ptr + max));
+    mctx.input_text_commit(written);
+    return true;
+}
+
+/**
+ * Renders `chars` with the font `Canvas2DRenderer` uses and hands their
+ * coverage to a `microui.Rasterizer`, which draws TEXT commands from them.
+ * @param {object} raster a `microui.Rasterizer`
+ * @param {string} chars e.g. the printable ASCII range
+ */
+export function load_glyphs(raster, chars) {
+    const canvas = new OffscreenCanvas(1, 1);
+    const ctx2d = canvas.getContext("2d");
     ctx2d.font = `${FONT_HEIGHT}px sans`;
-    ctx2d.fillStyle = color_to_hex(color);
-    const metrics = getMetrics(ctx2d, str, -1);
-    const y = pos.y + metrics.fontBoundingBoxAscent;
-    ctx2d.fillText(str, pos.x, y);
-    // debug
-    if (enable_debug) {
-        ctx2d.strokeStyle = "blue";
-        const y1 = y + metrics.fontBoundingBoxDescent;
-        const height = metrics.fontBoundingBoxAscent + metrics.fontBoundingBoxDescent;
-        ctx2d.strokeRect(pos.x, y1, metrics.width, -height);
+    const metrics = ctx2d.measureText("ABC");
+    const ascent = Math.ceil(metrics.fontBoundingBoxAscent);
+    const height = Math.ceil(metrics.fontBoundingBoxAscent + metrics.fontBoundingBoxDescent);
+    for (const ch of new Set(chars)) {
+        const advance = Math.round(ctx2d.measureText(ch).width);
+        // one pixel of room on both sides for antialiasing
+        const width = advance + 2;
+        canvas.width = width;
+        canvas.height = height;
+        // resizing resets the state
+        ctx2d.font = `${FONT_HEIGHT}px sans`;
+        ctx2d.fillStyle = "white";
+        ctx2d.fillText(ch, 1, ascent);
+        const rgba = ctx2d.getImageData(0, 0, width, height).data;
+        const alpha = new Uint8Array(width * height);
+        for (let i = 0; i < alpha.length; ++i)
+            alpha[i] = rgba[i * 4 + 3];
+        raster.set_glyph(ch.codePointAt(0), width, height, -1, 0, advance, alpha);
+    }
+}
+
+/**
+ * The framebuffer of a `microui.Rasterizer` as an `ImageData` for
+ * `putImageData`, without copying it. Valid until the rasterizer is resized
+ * or the WASM memory grows.
+ * @param {object} raster a `microui.Rasterizer`
+ * @returns {ImageData}
+ */
+export function raster_image(raster) {
+    const { width, height } = raster;
+    const pixels = new Uint8ClampedArray(microui.HEAPU8.buffer, raster.pixels_addr(), width * height * 4);
+    return new ImageData(pixels, width, height);
+}
+
+// Views of mu_Rect, mu_Vec2 and mu_Color in WASM memory. Unlike the embind
+// `Rect`/`Vec2`/`Color` objects nothing is copied: reads and writes go through
+// `HEAP32`/`HEAPU8`, looked up on each access since growing the memory
+// replaces them.
+
+export class RectView {
+    /** @param {number} addr byte address of a mu_Rect */
+    constructor(addr) {
+        this.i = addr >> 2;
+    }
+    get x() { return microui.HEAP32[this.i]; }
+    set x(v) { microui.HEAP32[this.i] = v; }
+    get y() { return microui.HEAP32[this.i + 1]; }
+    set y(v) { microui.HEAP32[this.i + 1] = v; }
+    get w() { return microui.HEAP32[this.i + 2]; }
+    set w(v) { microui.HEAP32[this.i + 2] = v; }
+    get h() { return microui.HEAP32[this.i + 3]; }
+    set h(v) { microui.HEAP32[this.i + 3] = v; }
+
+    set(x, y, w, h) {
+        const heap = microui.HEAP32, i = this.i;
+        heap[i] = x;
+        heap[i + 1] = y;
+        heap[i + 2] = w;
+        heap[i + 3] = h;
     }
 }
 
-function draw_rect(ctx2d, rect, color) {
-    ctx2d.fillStyle = color_to_hex(color);
-    ctx2d.fillRect(rect.x, rect.y, rect.w, rect.h);
+export class Vec2View {
+    /** @param {number} addr byte address of a mu_Vec2 */
+    constructor(addr) {
+        this.i = addr >> 2;
+    }
+    get x() { return microui.HEAP32[this.i]; }
+    set x(v) { microui.HEAP32[this.i] = v; }
+    get y() { return microui.HEAP32[this.i + 1]; }
+    set y(v) { microui.HEAP32[this.i + 1] = v; }
+
+    set(x, y) {
+        const heap = microui.HEAP32;
+        heap[this.i] = x;
+        heap[this.i + 1] = y;
+    }
+}
+
+export class ColorView {
+    /** @param {number} addr byte address of a mu_Color */
+    constructor(addr) {
+        this.i = addr;
+    }
+    get r() { return microui.HEAPU8[this.i]; }
+    set r(v) { microui.HEAPU8[this.i] = v; }
+    get g() { return microui.HEAPU8[this.i + 1]; }
+    set g(v) { microui.HEAPU8[this.i + 1] = v; }
+    get b() { return microui.HEAPU8[this.i + 2]; }
+    set b(v) { microui.HEAPU8[this.i + 2] = v; }
+    get a() { return microui.HEAPU8[this.i + 3]; }
+    set a(v) { microui.HEAPU8[this.i + 3] = v; }
+
+    set(r, g, b, a = 255) {
+        const heap = microui.HEAPU8, i = this.i;
+        heap[i] = r;
+        heap[i + 1] = g;
+        heap[i + 2] = b;
+        heap[i + 3] = a;
+    }
+}
+
+// a mu_Container in the context's pool; the address stays valid while the
+// container is retained
+export class ContainerView {
+    /** @param {number} addr byte address of a mu_Container */
+    constructor(addr) {
+        this.addr = addr;
+        this.rect = new RectView(addr + microui.CONTAINER_RECT);
+        this.body = new RectView(addr + microui.CONTAINER_BODY);
+        this.content_size = new Vec2View(addr + microui.CONTAINER_CONTENT_SIZE);
+        this.scroll = new Vec2View(addr + microui.CONTAINER_SCROLL);
+    }
 }
 
 /**
- * @param {CanvasRenderingContext2D} ctx2d
+ * The `_scratch` functions of a context behind the struct views: struct
+ * arguments are written to `rect`/`color` and struct results read back from
+ * `rect`, which the next call overwrites. The views are shared by all
+ * contexts.
  */
-function draw_icon(ctx2d, icon_id, rect, color) {
-    if (enable_debug) {
-        draw_rect(ctx2d, rect, { r: 10, g: 10, b: 250, a: 190 });
-    }
-    switch (icon_id) {
-        case microui.ICON_CLOSE: {
-            ctx2d.strokeStyle = color_to_hex(color);
-            ctx2d.lineWidth = 1.25;
-            ctx2d.lineCap = "square";
-            const r = 0.35;
-            ctx2d.beginPath();
-            ctx2d.moveTo(rect.x + rect.w * r, rect.y + rect.h * r);
-            ctx2d.lineTo(rect.x + rect.w * (1 - r), rect.y + rect.h * (1 - r));
-            ctx2d.moveTo(rect.x + rect.w * (1 - r), rect.y + rect.h * r);
-            ctx2d.lineTo(rect.x + rect.w * r, rect.y + rect.h * (1 - r));
-            ctx2d.stroke();
-            break;
-        }
-        case microui.ICON_CHECK: {
-            ctx2d.strokeStyle = color_to_hex(color);
-            ctx2d.lineWidth = 1.25;
-            ctx2d.lineCap = "square";
-            const dy1 = 0.55;
-            const dx1 = 0.2;
-            const dx2 = 0.15;
-            const dx3 = 0.4;
-            ctx2d.beginPath();
-            ctx2d.moveTo(rect.x + rect.w * dx1, rect.y + rect.h * dy1);
-            ctx2d.lineTo(rect.x + rect.w * (dx1 + dx2), rect.y + rect.h * (dy1 + dx2));
-            ctx2d.lineTo(rect.x + rect.w * (dx1 + dx2 + dx3), rect.y + rect.h * (dy1 + dx2 - dx3));
-            ctx2d.stroke();
-            break;
-        }
-        case microui.ICON_COLLAPSED: {
-            ctx2d.strokeStyle = color_to_hex(color);
-            ctx2d.lineWidth = 1.25;
-            ctx2d.lineCap = "square";
-            const r = 0.35;
-            const dx = 0.1;
-            ctx2d.beginPath();
-            ctx2d.moveTo(rect.x + rect.w * (r + dx), rect.y + rect.h * r);
-            ctx2d.lineTo(rect.x + rect.w * (0.5 + dx), rect.y + rect.h * 0.5);
-            ctx2d.lineTo(rect.x + rect.w * (r + dx), rect.y + rect.h * (1 - r));
-            ctx2d.stroke();
-            break;
-        }
-        case microui.ICON_EXPANDED: {
-            ctx2d.strokeStyle = color_to_hex(color);
-            ctx2d.lineWidth = 1.25;
-            ctx2d.lineCap = "square";
-            const r = 0.35;
-            const dy = 0.1;
-            ctx2d.beginPath();
-            ctx2d.moveTo(rect.x + rect.w * r, rect.y + rect.h * (r + dy));
-            ctx2d.lineTo(rect.x + rect.w * 0.5, rect.y + rect.h * (0.5 + dy));
-            ctx2d.lineTo(rect.x + rect.w * (1 - r), rect.y + rect.h * (r + dy));
-            ctx2d.stroke();
-            break;
+export class StructViews {
+    constructor(mctx) {
+        const addr = mctx.scratch_addr();
+        this.mctx = mctx;
+        this.rect = new RectView(addr + microui.SCRATCH_RECT);
+        this.color = new ColorView(addr + microui.SCRATCH_COLOR);
+        // pool addresses don't move, so each container gets one view
+        this.containers = new Map();
+    }
+
+    container_view(addr) {
+        let view = this.containers.get(addr);
+        if (view === undefined) {
+            view = new ContainerView(addr);
+            this.containers.set(addr, view);
         }
+        return view;
+    }
+
+    /** @param {string | number} title a string or a handle from `intern` */
+    begin_window(title, x, y, w, h, opt = 0) {
+        this.rect.set(x, y, w, h);
+        return typeof title === "number" ?
+            this.mctx.begin_window_ex_hashed_scratch(title, opt) : this.mctx.begin_window_ex_scratch(title, opt);
+    }
+
+    /** @returns {RectView} */
+    layout_next() {
+        this.mctx.layout_next_scratch();
+        return this.rect;
+    }
+
+    /** @returns {RectView} */
+    get_clip_rect() {
+        this.mctx.get_clip_rect_scratch();
+        return this.rect;
+    }
+
+    draw_rect(x, y, w, h, r, g, b, a = 255) {
+        this.rect.set(x, y, w, h);
+        this.color.set(r, g, b, a);
+        this.mctx.draw_rect_scratch();
+    }
+
+    /** @returns {ContainerView} */
+    current_container() {
+        return this.container_view(this.mctx.current_container_addr());
+    }
+
+    /** @returns {ContainerView} */
+    get_container(name) {
+        return this.container_view(this.mctx.container_addr(name));
     }
 }
 
-function set_clip_rect(ctx2d, rect) {
-    // NOTE: CanvasRenderingContext2D.clip would set the intersection with the previous clip region.
-    // draw_rect(ctx2d, rect, {r:0,g:0,b:255,a:255});
-    // ctx2d.beginPath();
-    // ctx2d.rect(rect.x, rect.y, rect.w, rect.h);
-    // ctx2d.strokeStyle = "blue";
-    // ctx2d.stroke()
-    // return;
-    ctx2d.restore();
-    ctx2d.save();
-    ctx2d.beginPath();
-    ctx2d.rect(rect.x, rect.y, rect.w, rect.h);
-    ctx2d.clip();
+// see `frame_builder.mjs`
+export class FrameBuilder extends ModuleFrameBuilder {
+    constructor(mctx) {
+        super(mctx, microui);
+    }
 }
 
-function hex2(c) {
-    const h = c.toString(16).toUpperCase();
-    return h.length == 1 ? "0" + h : h;
+let CONTROL_KEY_MAP;
+function map_control_key(k) {
+    if (CONTROL_KEY_MAP === undefined) {
+        CONTROL_KEY_MAP = new Map([
+            ["Shift", microui.KEY_SHIFT],
+            ["Control", microui.KEY_CTRL],
+            ["Alt", microui.KEY_ALT],
+            ["Enter", microui.KEY_RETURN],
+            ["Backspace", microui.KEY_BACKSPACE],
+        ]);
+    }
+    return CONTROL_KEY_MAP.get(k);
 }
 
-function color_to_hex(color) {
-    let str = "#" + hex2(color.r) + hex2(color.g) + hex2(color.b);
-    if (color.a !== undefined && color.a < 255)
-        str += hex2(color.a);
-    return str;
+// `(func (result v128) i32.const 0 i8x16.splat i8x16.popcnt)`
+const SIMD_PROBE = new Uint8Array([
+    0, 97, 115, 109, 1, 0, 0, 0, 1, 5, 1, 96, 0, 1, 123, 3, 2, 1, 0, 10, 10, 1, 8, 0, 65, 0, 253, 15, 253, 98, 11,
+]);
+
+// the SIMD128 build (`make simd`) when the engine supports it and it was built
+async function load_module() {
+    if (WebAssembly.validate(SIMD_PROBE)) {
+        try {
+            return (await import("../dist/microui-simd.mjs")).default;
+        } catch {
+            // not built, use the portable one
+        }
+    }
+    return (await import("../dist/microui.mjs")).default;
 }
 
-import MicroUiModuleLoader from "../dist/microui.mjs";
+const MicroUiModuleLoader = await load_module();
 
 var microui = await MicroUiModuleLoader();
 
+/**
+ * Lets every widget taking a label also take a handle from `mctx.intern(str)`.
+ * A handle is a number, so these dispatch on `typeof` and static labels skip
+ * the string conversion on each call.
+ * @param {object} proto `microui.Context.prototype`
+ */
+function install_label_handles(proto) {
+    const wrap1 = (by_string, by_handle) => function (label) {
+        return typeof label === "number" ? by_handle.call(this, label) : by_string.call(this, label);
+    };
+    const wrap2 = (by_string, by_handle) => function (label, a) {
+        return typeof label === "number" ? by_handle.call(this, label, a) : by_string.call(this, label, a);
+    };
+    const wrap3 = (by_string, by_handle) => function (label, a, b) {
+        return typeof label === "number" ? by_handle.call(this, label, a, b) : by_string.call(this, label, a, b);
+    };
+    const { label, button, button_ex, checkbox, header, header_ex, begin_treenode, begin_treenode_ex, begin_window,
+        begin_window_ex, open_popup, begin_popup, begin_panel, begin_panel_ex } = proto;
+    const align_center = microui.OPT_ALIGNCENTER;
+    proto.label = wrap1(label, proto.label_hashed);
+    proto.button = wrap1(button, function (h) { return this.button_ex_hashed(h, 0, align_center); });
+    proto.button_ex = wrap3(button_ex, proto.button_ex_hashed);
+    proto.checkbox = wrap2(checkbox, proto.checkbox_hashed);
+    proto.header = wrap1(header, function (h) { return this.header_ex_hashed(h, 0); });
+    proto.header_ex = wrap2(header_ex, proto.header_ex_hashed);
+    proto.begin_treenode = wrap1(begin_treenode, function (h) { return this.begin_treenode_ex_hashed(h, 0); });
+    proto.begin_treenode_ex = wrap2(begin_treenode_ex, proto.begin_treenode_ex_hashed);
+    proto.begin_window = wrap2(begin_window, function (h, rect) { return this.begin_window_ex_hashed(h, rect, 0); });
+    proto.begin_window_ex = wrap3(begin_window_ex, proto.begin_window_ex_hashed);
+    proto.open_popup = wrap1(open_popup, proto.open_popup_hashed);
+    proto.begin_popup = wrap1(begin_popup, proto.begin_popup_hashed);
+    proto.begin_panel = wrap1(begin_panel, function (h) { return this.begin_panel_ex_hashed(h, 0); });
+    proto.begin_panel_ex = wrap2(begin_panel_ex, proto.begin_panel_ex_hashed);
+}
+
+install_label_handles(microui.Context.prototype);
+
 export default microui;
 
 export { microui };
@@ -0,0 +1,75 @@
+// Paints frames on an OffscreenCanvas in a worker, see the `worker` option of
+// `Canvas2DRenderer`. Messages:
+//
+//   { type: "init", canvas, scale }       the transferred OffscreenCanvas
+//   { type: "frame", frame, background }  a frame made by `copy_frame`
+//   { type: "shared", memory, addr, background }
+//                                         paint whatever a `SharedFrameReader`
+//                                         over `memory` picks up, every frame
+//   { type: "invalidate" }                repaint everything next time
+//   { type: "stop" }                      stop polling the shared frames
+//
+// Frames that arrive faster than they can be painted are dropped, only the
+// newest one is painted.
+
+import { FramePainter, SharedFrameReader } from "./replay.mjs";
+
+let painter = null;
+let pending = null;
+let reader = null;
+let shared_background;
+let scheduled = false;
+
+const next_tick = typeof requestAnimationFrame === "function" ?
+    fn => requestAnimationFrame(fn) : fn => setTimeout(fn, 16);
+
+function schedule() {
+    if (!scheduled) {
+        scheduled = true;
+        next_tick(tick);
+    }
+}
+
+function tick() {
+    scheduled = false;
+    if (painter === null)
+        return;
+    if (pending !== null) {
+        painter.paint(pending.frame, pending.background);
+        pending = null;
+    }
+    if (reader !== null) {
+        const frame = reader.acquire();
+        if (frame !== null)
+            painter.paint(frame, shared_background);
+        schedule();
+    }
+}
+
+self.onmessage = ev => {
+    const msg = ev.data;
+    switch (msg.type) {
+        case "init": {
+            const ctx2d = msg.canvas.getContext("2d");
+            ctx2d.scale(msg.scale, msg.scale);
+            painter = new FramePainter(ctx2d);
+            break;
+        }
+        case "frame":
+            pending = msg;
+            schedule();
+            break;
+        case "shared":
+            reader = new SharedFrameReader(msg.memory, msg.addr);
+            shared_background = msg.background;
+            schedule();
+            break;
+        case "invalidate":
+            if (painter !== null)
+                painter.invalidate();
+            break;
+        case "stop":
+            reader = null;
+            break;
+    }
+};
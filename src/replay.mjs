@@ -0,0 +1,634 @@
+// Replays packed frames (see `packed_commands.h`) on a 2D canvas context.
+// Nothing here touches the WASM module, so it also runs in a worker painting
+// an OffscreenCanvas, or under Node with a stub context.
+
+// mirror microui.h, packed_commands.h and frame_exchange.h
+export const mu = {
+    COMMAND_CLIP: 2,
+    COMMAND_RECT: 3,
+    COMMAND_TEXT: 4,
+    COMMAND_ICON: 5,
+
+    ICON_CLOSE: 1,
+    ICON_CHECK: 2,
+    ICON_COLLAPSED: 3,
+    ICON_EXPANDED: 4,
+
+    PACKED_TYPE: 0,
+    PACKED_X: 1,
+    PACKED_Y: 2,
+    PACKED_W: 3,
+    PACKED_H: 4,
+    PACKED_COLOR: 5,
+    PACKED_ARG0: 6,
+    PACKED_ARG1: 7,
+    PACKED_WORDS: 8,
+    PACKED_TEXT_OFFSET: 3,
+    PACKED_TEXT_LEN: 4,
+    PACKED_TEXT_ID: 6,
+    PACKED_TEXT_WIDTH: 7,
+
+    DAMAGE_MAX: 16,
+    FRAME_SERIAL: 0,
+    FRAME_COUNT: 1,
+    FRAME_RECORDS: 2,
+    FRAME_TEXT: 3,
+    FRAME_TEXT_GENERATION: 4,
+    FRAME_HASH: 5,
+    FRAME_DAMAGE_BASE: 6,
+    FRAME_DAMAGE_COUNT: 7,
+    FRAME_DAMAGE: 8,
+    FRAME_WORDS: 8 + 16 * 4,
+    FRAME_FRESH: 4,
+};
+
+const enable_debug = false;
+
+export const FONT_HEIGHT = 12;
+
+/**
+ * @param {CanvasRenderingContext2D} ctx2d
+ * @param {string} str
+ * @returns {TextMetrics}
+ */
+export function measure_text(ctx2d, str) {
+    ctx2d.save();
+    ctx2d.font = `${FONT_HEIGHT}px sans`;
+    const metrics = ctx2d.measureText(str);
+    ctx2d.restore();
+    return metrics;
+}
+
+/**
+ * A packed frame (see `packed_commands.h`) and where to find it.
+ * @typedef {object} PackedFrame
+ * @property {ArrayBuffer | SharedArrayBuffer} buffer the WASM memory
+ * @property {number} [serial] set for frames read by `SharedFrameReader`
+ * @property {number} records byte address of the first record
+ * @property {number} count
+ * @property {number} text byte address that TEXT offsets are relative to
+ * @property {number} text_generation
+ * @property {number} hash
+ * @property {number} damage_base
+ * @property {number} damage byte address of `damage_count` rects
+ * @property {number} damage_count
+ */
+
+/**
+ * Paints packed frames on one 2D context, remembering what is on it: a frame
+ * that hashes the same as the painted one (on the same background) is
+ * skipped, and a frame whose damage is relative to the painted one only
+ * repaints the damaged rects.
+ */
+export class FramePainter {
+    /**
+     * @param {CanvasRenderingContext2D} ctx2d
+     */
+    constructor(ctx2d) {
+        this.ctx2d = ctx2d;
+        this.painted_hash = undefined;
+        this.painted_background = undefined;
+        // decoded strings of the packed text table, keyed by string id. ids
+        // are only unique within one context's table, so each painter keeps
+        // its own
+        this.text_cache = { generation: -1, strings: new Map() };
+    }
+
+    /**
+     * @param {PackedFrame} frame
+     * @param {string} [background] CSS color the canvas is cleared with first;
+     *     without it every changed frame is replayed over the whole canvas
+     * @returns {boolean} whether the canvas was repainted
+     */
+    paint(frame, background) {
+        const hash = frame.hash;
+        if (hash === this.painted_hash && background === this.painted_background)
+            return false;
+        // the damage is relative to the previous frame, which must be the one
+        // on the canvas
+        const partial = background !== undefined && background === this.painted_background &&
+            this.painted_hash !== undefined && frame.damage_base === this.painted_hash;
+        this.painted_hash = hash;
+        this.painted_background = background;
+
+        const ctx2d = this.ctx2d;
+        let damage = null;
+        ctx2d.save();
+        if (partial) {
+            damage = read_damage(frame);
+            ctx2d.beginPath();
+            for (let i = 0; i < damage.length; i += 4)
+                ctx2d.rect(damage[i], damage[i + 1], damage[i + 2], damage[i + 3]);
+            ctx2d.clip();
+            ctx2d.fillStyle = background;
+            for (let i = 0; i < damage.length; i += 4)
+                ctx2d.fillRect(damage[i], damage[i + 1], damage[i + 2], damage[i + 3]);
+        } else if (background !== undefined) {
+            ctx2d.save();
+            ctx2d.setTransform(1, 0, 0, 1, 0, 0);
+            ctx2d.fillStyle = background;
+            ctx2d.fillRect(0, 0, ctx2d.canvas.width, ctx2d.canvas.height);
+            ctx2d.restore();
+        }
+        process_commands(frame, ctx2d, damage, this.text_cache);
+        ctx2d.restore();
+        return true;
+    }
+
+    // the next `paint` repaints everything
+    invalidate() {
+        this.painted_hash = undefined;
+    }
+}
+
+/**
+ * Copies `frame` into an ArrayBuffer of its own, e.g. to transfer it to a
+ * worker: the records, then the damaged rects, then the drawn strings.
+ * @param {PackedFrame} frame
+ * @returns {PackedFrame}
+ */
+export function copy_frame(frame) {
+    const W = mu.PACKED_WORDS;
+    const src = new Int32Array(frame.buffer);
+    const src_bytes = new Uint8Array(frame.buffer);
+    const records = frame.records >> 2;
+    const n = frame.count * W;
+    let text_len = 0;
+    for (let p = records; p < records + n; p += W) {
+        if (src[p + mu.PACKED_TYPE] === mu.COMMAND_TEXT)
+            text_len += src[p + mu.PACKED_TEXT_LEN];
+    }
+    const damage = n * 4;
+    const text = damage + frame.damage_count * 16;
+    // whole words, so the buffer can be viewed as an Int32Array
+    const buffer = new ArrayBuffer((text + text_len + 3) & ~3);
+    const words = new Int32Array(buffer, 0, text >> 2);
+    const bytes = new Uint8Array(buffer);
+    words.set(src.subarray(records, records + n));
+    words.set(src.subarray(frame.damage >> 2, (frame.damage >> 2) + frame.damage_count * 4), n);
+    // strings are packed back to back, in record order
+    let offset = 0;
+    for (let p = 0; p < n; p += W) {
+        if (words[p + mu.PACKED_TYPE] !== mu.COMMAND_TEXT)
+            continue;
+        const addr = frame.text + words[p + mu.PACKED_TEXT_OFFSET];
+        const len = words[p + mu.PACKED_TEXT_LEN];
+        bytes.set(src_bytes.subarray(addr, addr + len), text + offset);
+        words[p + mu.PACKED_TEXT_OFFSET] = offset;
+        offset += len;
+    }
+    return {
+        buffer,
+        serial: frame.serial,
+        count: frame.count,
+        records: 0,
+        text,
+        text_generation: frame.text_generation,
+        hash: frame.hash,
+        damage_base: frame.damage_base,
+        damage,
+        damage_count: frame.damage_count,
+    };
+}
+
+/**
+ * Reads the frames that a context in another thread publishes with
+ * `publish_frame()`, straight from its shared WASM memory (see
+ * `FrameExchange`). Neither side waits for the other: the producer keeps
+ * publishing while a frame is painted and `acquire` only returns the newest.
+ */
+export class SharedFrameReader {
+    /**
+     * @param {WebAssembly.Memory} memory the producer's `wasmMemory`
+     * @param {number} addr the producer's `frame_exchange_addr()`
+     */
+    constructor(memory, addr) {
+        this.memory = memory;
+        this.state = addr >> 2;
+        this.front = 1;
+    }
+
+    /**
+     * The frame stays valid until the next call.
+     * @returns {PackedFrame | null} null when nothing was published since the last call
+     */
+    acquire() {
+        // the memory may have grown since, don't keep views around
+        const heap = new Int32Array(this.memory.buffer);
+        if ((Atomics.load(heap, this.state) & mu.FRAME_FRESH) === 0)
+            return null;
+        this.front = Atomics.exchange(heap, this.state, this.front) & ~mu.FRAME_FRESH;
+        const h = this.state + 1 + this.front * mu.FRAME_WORDS;
+        return {
+            buffer: heap.buffer,
+            serial: heap[h + mu.FRAME_SERIAL],
+            count: heap[h + mu.FRAME_COUNT],
+            records: heap[h + mu.FRAME_RECORDS],
+            text: heap[h + mu.FRAME_TEXT],
+            text_generation: heap[h + mu.FRAME_TEXT_GENERATION],
+            // the same unsigned value `frame_hash` reports
+            hash: heap[h + mu.FRAME_HASH] >>> 0,
+            damage_base: heap[h + mu.FRAME_DAMAGE_BASE] >>> 0,
+            damage: (h + mu.FRAME_DAMAGE) * 4,
+            damage_count: heap[h + mu.FRAME_DAMAGE_COUNT],
+        };
+    }
+}
+
+// copies the damaged rects as flat `x, y, w, h` quadruples, grown by a pixel
+// so antialiased edges of neighbouring shapes are repainted too
+function read_damage(frame) {
+    const count = frame.damage_count;
+    const heap = new Int32Array(frame.buffer);
+    const base = frame.damage >> 2;
+    const rects = new Int32Array(count * 4);
+    for (let i = 0; i < count * 4; i += 4) {
+        rects[i] = heap[base + i] - 1;
+        rects[i + 1] = heap[base + i + 1] - 1;
+        rects[i + 2] = heap[base + i + 2] + 2;
+        rects[i + 3] = heap[base + i + 3] + 2;
+    }
+    return rects;
+}
+
+function touches_damage(damage, x, y, w, h) {
+    for (let i = 0; i < damage.length; i += 4) {
+        if (x < damage[i] + damage[i + 2] && damage[i] < x + w &&
+            y < damage[i + 1] + damage[i + 3] && damage[i + 1] < y + h)
+            return true;
+    }
+    return false;
+}
+
+// batches never look back further than this for one of their colour
+const MAX_LOOKBACK = 32;
+// text boxes are measured, glyphs may stick out of them a little; the same
+// margin as in `CommandPacker::optimize` and the core's text damage
+const TEXT_MARGIN = 2;
+
+/**
+ * Queues the commands between two CLIPs in batches of one kind and colour, so
+ * each batch costs one `fillStyle` and, for rects, one path fill. A command
+ * joins the newest batch of its kind and colour unless it overlaps something
+ * queued after that batch (or, for translucent rects, something in the batch
+ * itself), so overlapping commands are still painted in order.
+ */
+class CommandBatches {
+    constructor() {
+        // reused across frames, only the first `used` are queued
+        this.batches = [];
+        this.used = 0;
+        // the `fillStyle` set since the last clip change
+        this.fill_style = null;
+    }
+
+    /**
+     * @param {number} kind a `COMMAND_*` type
+     * @param {number} color packed rgba
+     * @param {string | number} extra the string of TEXT, the icon id of ICON
+     */
+    add(kind, color, x, y, w, h, extra) {
+        const translucent = kind === mu.COMMAND_RECT && (color >>> 24) !== 255;
+        let target = null;
+        const stop = Math.max(this.used - MAX_LOOKBACK, 0);
+        for (let i = this.used - 1; i >= stop; --i) {
+            const batch = this.batches[i];
+            if (batch.kind === kind && batch.color === color) {
+                if (!translucent || !batch.overlaps(x, y, w, h))
+                    target = batch;
+                break;
+            }
+            if (batch.overlaps(x, y, w, h))
+                break;
+        }
+        if (target === null) {
+            if (this.used === this.batches.length)
+                this.batches.push(new Batch());
+            target = this.batches[this.used++];
+            target.reset(kind, color);
+        }
+        target.push(x, y, w, h, extra);
+    }
+
+    /**
+     * @param {CanvasRenderingContext2D} ctx2d
+     */
+    flush(ctx2d) {
+        let font_set = false;
+        for (let i = 0; i < this.used; ++i) {
+            const batch = this.batches[i];
+            const color = packed_color_to_hex(batch.color);
+            const boxes = batch.boxes;
+            const n = batch.extras.length;
+            switch (batch.kind) {
+                case mu.COMMAND_RECT:
+                    this.set_fill(ctx2d, color);
+                    if (n === 1) {
+                        ctx2d.fillRect(boxes[0], boxes[1], boxes[2], boxes[3]);
+                        break;
+                    }
+                    ctx2d.beginPath();
+                    for (let j = 0; j < n * 4; j += 4)
+                        ctx2d.rect(boxes[j], boxes[j + 1], boxes[j + 2], boxes[j + 3]);
+                    ctx2d.fill();
+                    break;
+                case mu.COMMAND_TEXT:
+                    if (!font_set) {
+                        ctx2d.font = `${FONT_HEIGHT}px sans`;
+                        font_set = true;
+                    }
+                    this.set_fill(ctx2d, color);
+                    for (let j = 0; j < n; ++j)
+                        draw_text(ctx2d, batch.extras[j], boxes[j * 4] + TEXT_MARGIN, boxes[j * 4 + 1] + TEXT_MARGIN);
+                    break;
+                case mu.COMMAND_ICON:
+                    for (let j = 0; j < n; ++j)
+                        draw_icon(ctx2d, batch.extras[j], boxes[j * 4], boxes[j * 4 + 1], boxes[j * 4 + 2],
+                            boxes[j * 4 + 3], color);
+                    // the debug boxes of icons set the fill style
+                    if (enable_debug)
+                        this.fill_style = null;
+                    break;
+            }
+        }
+        this.used = 0;
+    }
+
+    set_fill(ctx2d, color) {
+        if (this.fill_style !== color) {
+            ctx2d.fillStyle = color;
+            this.fill_style = color;
+        }
+    }
+
+    // `restore` reset the context state
+    clip_changed() {
+        this.fill_style = null;
+    }
+}
+
+class Batch {
+    constructor() {
+        this.kind = 0;
+        this.color = 0;
+        // x, y, w, h of each command
+        this.boxes = [];
+        this.extras = [];
+        // bounds of all boxes
+        this.x0 = 0;
+        this.y0 = 0;
+        this.x1 = 0;
+        this.y1 = 0;
+    }
+
+    reset(kind, color) {
+        this.kind = kind;
+        this.color = color;
+        this.boxes.length = 0;
+        this.extras.length = 0;
+        this.x0 = this.y0 = Infinity;
+        this.x1 = this.y1 = -Infinity;
+    }
+
+    push(x, y, w, h, extra) {
+        this.boxes.push(x, y, w, h);
+        this.extras.push(extra);
+        this.x0 = Math.min(this.x0, x);
+        this.y0 = Math.min(this.y0, y);
+        this.x1 = Math.max(this.x1, x + w);
+        this.y1 = Math.max(this.y1, y + h);
+    }
+
+    overlaps(x, y, w, h) {
+        if (x >= this.x1 || this.x0 >= x + w || y >= this.y1 || this.y0 >= y + h)
+            return false;
+        const boxes = this.boxes;
+        for (let j = 0; j < boxes.length; j += 4) {
+            if (x < boxes[j] + boxes[j + 2] && boxes[j] < x + w && y < boxes[j + 1] + boxes[j + 3] && boxes[j + 1] < y + h)
+                return true;
+        }
+        return false;
+    }
+}
+
+const batches = new CommandBatches();
+
+/**
+ * @param {PackedFrame} frame
+ * @param {CanvasRenderingContext2D} ctx2d
+ * @param {Int32Array?} damage only commands touching these rects are replayed
+ * @param {object} text_cache the painter's decoded strings
+ */
+function process_commands(frame, ctx2d, damage, text_cache) {
+    ctx2d.save();
+    batches.clip_changed();
+
+    // the packed buffer lives in WASM memory, read it in place without creating
+    // an object for each command
+    const count = frame.count;
+    const W = mu.PACKED_WORDS;
+    const words = new Int32Array(frame.buffer);
+    const bytes = new Uint8Array(frame.buffer);
+    const base = frame.records >> 2;
+    const text_base = frame.text;
+    const text_height = font_height(ctx2d);
+    if (text_cache.generation !== frame.text_generation) {
+        text_cache.generation = frame.text_generation;
+        text_cache.strings.clear();
+    }
+    for (let i = 0; i < count; ++i) {
+        const p = base + i * W;
+        const x = words[p + mu.PACKED_X];
+        const y = words[p + mu.PACKED_Y];
+        const type = words[p + mu.PACKED_TYPE];
+        if (damage !== null && type !== mu.COMMAND_CLIP) {
+            const touches = type === mu.COMMAND_TEXT
+                ? touches_damage(damage, x - TEXT_MARGIN, y - TEXT_MARGIN,
+                    words[p + mu.PACKED_TEXT_WIDTH] + 2 * TEXT_MARGIN, text_height + 2 * TEXT_MARGIN)
+                : touches_damage(damage, x, y, words[p + mu.PACKED_W], words[p + mu.PACKED_H]);
+            if (!touches)
+                continue;
+        }
+        switch (type) {
+            case mu.COMMAND_TEXT: {
+                const str = packed_text(text_cache, bytes, words[p + mu.PACKED_TEXT_ID],
+                    text_base + words[p + mu.PACKED_TEXT_OFFSET], words[p + mu.PACKED_TEXT_LEN]);
+                batches.add(type, words[p + mu.PACKED_COLOR], x - TEXT_MARGIN, y - TEXT_MARGIN,
+                    words[p + mu.PACKED_TEXT_WIDTH] + 2 * TEXT_MARGIN, text_height + 2 * TEXT_MARGIN, str);
+                break;
+            }
+            case mu.COMMAND_RECT:
+            case mu.COMMAND_ICON:
+                batches.add(type, words[p + mu.PACKED_COLOR], x, y, words[p + mu.PACKED_W], words[p + mu.PACKED_H],
+                    words[p + mu.PACKED_ARG0]);
+                break;
+            case mu.COMMAND_CLIP:
+                batches.flush(ctx2d);
+                set_clip_rect(ctx2d, x, y, words[p + mu.PACKED_W], words[p + mu.PACKED_H]);
+                batches.clip_changed();
+                break;
+        }
+    }
+    batches.flush(ctx2d);
+
+    ctx2d.restore();
+}
+
+const text_decoder = new TextDecoder();
+
+function packed_text(text_cache, bytes, id, addr, len) {
+    let str = text_cache.strings.get(id);
+    if (str === undefined) {
+        // `TextDecoder` refuses views of a SharedArrayBuffer, decode a copy
+        str = text_decoder.decode(bytes.slice(addr, addr + len));
+        text_cache.strings.set(id, str);
+    }
+    return str;
+}
+
+// the ascent and height only depend on the font, measure them once
+let font_ascent;
+let font_line_height;
+
+function font_height(ctx2d) {
+    if (font_line_height === undefined) {
+        const metrics = measure_text(ctx2d, "ABC");
+        font_line_height = metrics.fontBoundingBoxAscent + metrics.fontBoundingBoxDescent;
+    }
+    return font_line_height;
+}
+
+/**
+ * Expects the font and fill style to be set.
+ * @param {CanvasRenderingContext2D} ctx2d
+ */
+function draw_text(ctx2d, str, x, y) {
+    if (font_ascent === undefined)
+        font_ascent = measure_text(ctx2d, "ABC").fontBoundingBoxAscent;
+    const baseline = y + font_ascent;
+    ctx2d.fillText(str, x, baseline);
+    // debug
+    if (enable_debug) {
+        const metrics = measure_text(ctx2d, str);
+        ctx2d.strokeStyle = "blue";
+        const y1 = baseline + metrics.fontBoundingBoxDescent;
+        const height = metrics.fontBoundingBoxAscent + metrics.fontBoundingBoxDescent;
+        ctx2d.strokeRect(x, y1, metrics.width, -height);
+    }
+}
+
+function draw_rect(ctx2d, x, y, w, h, color) {
+    ctx2d.fillStyle = color;
+    ctx2d.fillRect(x, y, w, h);
+}
+
+/**
+ * @param {CanvasRenderingContext2D} ctx2d
+ */
+function draw_icon(ctx2d, icon_id, x, y, w, h, color) {
+    if (enable_debug) {
+        draw_rect(ctx2d, x, y, w, h, color_to_hex({ r: 10, g: 10, b: 250, a: 190 }));
+    }
+    switch (icon_id) {
+        case mu.ICON_CLOSE: {
+            ctx2d.strokeStyle = color;
+            ctx2d.lineWidth = 1.25;
+            ctx2d.lineCap = "square";
+            const r = 0.35;
+            ctx2d.beginPath();
+            ctx2d.moveTo(x + w * r, y + h * r);
+            ctx2d.lineTo(x + w * (1 - r), y + h * (1 - r));
+            ctx2d.moveTo(x + w * (1 - r), y + h * r);
+            ctx2d.lineTo(x + w * r, y + h * (1 - r));
+            ctx2d.stroke();
+            break;
+        }
+        case mu.ICON_CHECK: {
+            ctx2d.strokeStyle = color;
+            ctx2d.lineWidth = 1.25;
+            ctx2d.lineCap = "square";
+            const dy1 = 0.55;
+            const dx1 = 0.2;
+            const dx2 = 0.15;
+            const dx3 = 0.4;
+            ctx2d.beginPath();
+            ctx2d.moveTo(x + w * dx1, y + h * dy1);
+            ctx2d.lineTo(x + w * (dx1 + dx2), y + h * (dy1 + dx2));
+            ctx2d.lineTo(x + w * (dx1 + dx2 + dx3), y + h * (dy1 + dx2 - dx3));
+            ctx2d.stroke();
+            break;
+        }
+        case mu.ICON_COLLAPSED: {
+            ctx2d.strokeStyle = color;
+            ctx2d.lineWidth = 1.25;
+            ctx2d.lineCap = "square";
+            const r = 0.35;
+            const dx = 0.1;
+            ctx2d.beginPath();
+            ctx2d.moveTo(x + w * (r + dx), y + h * r);
+            ctx2d.lineTo(x + w * (0.5 + dx), y + h * 0.5);
+            ctx2d.lineTo(x + w * (r + dx), y + h * (1 - r));
+            ctx2d.stroke();
+            break;
+        }
+        case mu.ICON_EXPANDED: {
+            ctx2d.strokeStyle = color;
+            ctx2d.lineWidth = 1.25;
+            ctx2d.lineCap = "square";
+            const r = 0.35;
+            const dy = 0.1;
+            ctx2d.beginPath();
+            ctx2d.moveTo(x + w * r, y + h * (r + dy));
+            ctx2d.lineTo(x + w * 0.5, y + h * (0.5 + dy));
+            ctx2d.lineTo(x + w * (1 - r), y + h * (r + dy));
+            ctx2d.stroke();
+            break;
+        }
+    }
+}
+
+function set_clip_rect(ctx2d, x, y, w, h) {
+    // NOTE: CanvasRenderingContext2D.clip would set the intersection with the previous clip region.
+    // draw_rect(ctx2d, rect, {r:0,g:0,b:255,a:255});
+    // ctx2d.beginPath();
+    // ctx2d.rect(rect.x, rect.y, rect.w, rect.h);
+    // ctx2d.strokeStyle = "blue";
+    // ctx2d.stroke()
+    // return;
+    ctx2d.restore();
+    ctx2d.save();
+    ctx2d.beginPath();
+    ctx2d.rect(x, y, w, h);
+    ctx2d.clip();
+}
+
+function hex2(c) {
+    const h = c.toString(16).toUpperCase();
+    return h.length == 1 ? "0" + h : h;
+}
+
+function color_to_hex(color) {
+    let str = "#" + hex2(color.r) + hex2(color.g) + hex2(color.b);
+    if (color.a !== undefined && color.a < 255)
+        str += hex2(color.a);
+    return str;
+}
+
+// CSS strings of packed colours; a UI only uses a handful of them
+const color_strings = new Map();
+const MAX_COLOR_STRINGS = 4096;
+
+// `rgba` is a `mu_Color` read as a little-endian int32
+function packed_color_to_hex(rgba) {
+    let str = color_strings.get(rgba);
+    if (str !== undefined)
+        return str;
+    const a = rgba >>> 24;
+    str = "#" + hex2(rgba & 0xFF) + hex2((rgba >> 8) & 0xFF) + hex2((rgba >> 16) & 0xFF);
+    if (a < 255)
+        str += hex2(a);
+    if (color_strings.size >= MAX_COLOR_STRINGS)
+        color_strings.clear();
+    color_strings.set(rgba, str);
+    return str;
+}
@@ -0,0 +1,161 @@
+// Checks `FrameBuilder` programs against the direct calls they encode, and
+// that `run_frame` turns down malformed ones. The programs run natively in
+// `build/bench --frame-program` (`make -C wasm-src bench`), so this needs no
+// WASM build. Run with `node test/frame_program.mjs`.
+
+import assert from "node:assert/strict";
+import { spawnSync } from "node:child_process";
+import { fileURLToPath } from "node:url";
+import { FrameBuilder, op } from "../src/frame_builder.mjs";
+
+const BENCH = fileURLToPath(new URL("../build/bench", import.meta.url));
+const RES_ACTIVE = 1;
+const OPT_EXPANDED = 4096;
+const ICON_CHECK = 2;
+
+// runs `words` with the label table `labels` next to bench.cpp's
+// `frame_program_reference`, returns its verdict and results
+function run_words(labels, words) {
+    const input = `${labels.length}\n${labels.map(l => l + "\n").join("")}${words.join(" ")}\n`;
+    const out = spawnSync(BENCH, ["--frame-program"], { input, encoding: "utf8" });
+    assert.equal(out.error, undefined, `can't run ${BENCH}: ${out.error}`);
+    const [verdict, ...results] = out.stdout.trim().split(" ");
+    return { status: out.status, verdict: out.status === 1 ? out.stdout.trim() : verdict, results: results.map(Number) };
+}
+
+// a `Context` and module whose `run_frame` hands the program to the bench
+class StubModule {
+    constructor() {
+        this.HEAP32 = new Int32Array(1024);
+        this.top = 16;
+        this.labels = [];
+        this.verdict = null;
+    }
+    reserve(words) {
+        const addr = this.top * 4;
+        this.top += words;
+        assert.ok(this.top <= this.HEAP32.length);
+        return addr;
+    }
+    context() {
+        const module = this;
+        let results = 0;
+        return {
+            intern(str) {
+                module.labels.push(str);
+                return module.labels.length - 1;
+            },
+            frame_code_reserve(words) {
+                return module.reserve(words);
+            },
+            frame_results_reserve(count) {
+                return results = module.reserve(count);
+            },
+            run_frame(addr, len) {
+                const words = Array.from(module.HEAP32.subarray(addr >> 2, (addr >> 2) + len));
+                const { verdict, results: values } = run_words(module.labels, words);
+                module.verdict = verdict;
+                if (verdict !== "match")
+                    return -1;
+                module.HEAP32.set(values.slice(0, 16), results >> 2);
+                return 0;
+            },
+        };
+    }
+}
+
+// the same frame as `frame_program_reference`, unless `leaf` is changed
+function build_reference(fb, leaf = "leaf") {
+    const s = {};
+    s.window = fb.begin_window("Frame Program", 10, 10, 300, 400);
+    s.buttons = fb.header("Buttons", OPT_EXPANDED);
+    fb.layout_row([100, -1], 0);
+    s.button1 = fb.button("Button 1");
+    s.button2 = fb.button("Button 2");
+    fb.end_header();
+    s.closed = fb.header("Closed");
+    fb.label("hidden");
+    fb.end_header();
+    s.tree = fb.begin_treenode("Tree", OPT_EXPANDED);
+    fb.push_id(42);
+    fb.label("leaf");
+    s.icon = fb.button(null, ICON_CHECK, 0);
+    fb.pop_id();
+    fb.end_treenode();
+    fb.layout_row([140, -1], 60);
+    fb.layout_begin_column();
+    fb.label("column");
+    fb.layout_end_column();
+    fb.begin_panel("Panel");
+    fb.text(leaf);
+    fb.end_panel();
+    fb.end_window();
+    return s;
+}
+
+{
+    const module = new StubModule();
+    const fb = new FrameBuilder(module.context(), module);
+    const s = build_reference(fb);
+    assert.equal(fb.run(), 0, module.verdict);
+    assert.equal(module.verdict, "match");
+    // the results of the last of the bench's frames; its clicks may have
+    // closed the treenode
+    assert.ok(fb.result(s.window) & RES_ACTIVE);
+    assert.ok(fb.result(s.buttons) & RES_ACTIVE);
+    assert.equal(fb.result(s.closed) & RES_ACTIVE, 0);
+    // a builder that isn't reset runs the same frame again
+    assert.equal(fb.run(), 0);
+    // a program that draws something else is noticed
+    fb.reset();
+    build_reference(fb, "other leaf");
+    assert.equal(fb.run(), -1);
+    assert.match(module.verdict, /^commands differ at frame 0/);
+}
+
+{
+    const module = new StubModule();
+    const fb = new FrameBuilder(module.context(), module);
+    fb.begin_window("Frame Program", 10, 10, 300, 400);
+    assert.throws(() => fb.end_treenode(), /mismatched end of block/);
+    fb.reset();
+    fb.header("Buttons");
+    assert.throws(() => fb.run(), /not closed/);
+}
+
+// malformed programs are turned down before anything runs
+const labels = ["Frame Program", "leaf"];
+const rejected = {
+    "unknown op": [op.END_PANEL + 1],
+    "negative op": [-1],
+    "op cut short": [op.TEXT],
+    "LAYOUT_ROW widths cut short": [op.LAYOUT_ROW, 2, 0, 100],
+    "too many LAYOUT_ROW widths": [op.LAYOUT_ROW, 17, 0],
+    "unknown label": [op.TEXT, 2],
+    "negative label": [op.LABEL, -1],
+    "unknown optional label": [op.BUTTON, 0, 2, 0, 0],
+    "result slot out of range": [op.BUTTON, 16, 1, 0, 0],
+    "skip past the end": [op.HEADER, 0, 1, 0, 3, op.TEXT, 1],
+    "negative skip": [op.HEADER, 0, 1, 0, -1, op.TEXT, 1],
+    // lands on the label word of TEXT
+    "skip into an op": [op.HEADER, 0, 1, 0, 1, op.TEXT, 1],
+    "skip into a LAYOUT_ROW width": [op.BEGIN_POPUP, 0, 1, 4, op.LAYOUT_ROW, 2, 0, 100, -1],
+};
+for (const [what, words] of Object.entries(rejected)) {
+    const { status, verdict } = run_words(labels, words);
+    assert.equal(verdict, "rejected", what);
+    assert.equal(status, 2, what);
+}
+// the same skips when they land on an op or the end are accepted; in a
+// window, as widgets need one to run
+for (const body of [
+    [op.HEADER, 1, 1, 0, 2, op.TEXT, 1],
+    [op.HEADER, 1, 1, 0, 0, op.TEXT, 1],
+    [op.BEGIN_POPUP, 1, 1, 5, op.LAYOUT_ROW, 2, 0, 100, -1],
+]) {
+    const words = [op.BEGIN_WINDOW, 0, 0, 10, 10, 300, 400, 0, body.length + 1, ...body, op.END_WINDOW];
+    const { status, verdict } = run_words(labels, words);
+    assert.equal(status, 1, `${verdict}: ${body.join(" ")}`);
+}
+
+console.log("frame_program: ok");
@@ -0,0 +1,231 @@
+// Headless checks of the frame replay and the render worker, with a stub 2D
+// context that records what is drawn. Run with `node test/replay.mjs`.
+
+import assert from "node:assert/strict";
+import { mu, FramePainter, SharedFrameReader, copy_frame } from "../src/replay.mjs";
+
+class StubContext2D {
+    constructor() {
+        this.canvas = { width: 800, height: 600 };
+        this.calls = [];
+    }
+    measureText(str) {
+        return { width: str.length * 7, fontBoundingBoxAscent: 10, fontBoundingBoxDescent: 4 };
+    }
+    fills() {
+        return this.calls.filter(c => c.startsWith("fill"));
+    }
+}
+for (const name of ["save", "restore", "scale", "setTransform", "beginPath", "rect", "clip", "fill", "fillRect",
+    "fillText", "moveTo", "lineTo", "stroke", "strokeRect"]) {
+    StubContext2D.prototype[name] = function (...args) {
+        this.calls.push(`${name}(${args.join(",")})`);
+    };
+}
+
+const encoder = new TextEncoder();
+
+// packs `commands` like `CommandPacker` does, into `buffer` at `addr`
+function make_frame(commands, { hash, damage_base = 0, damage = [], buffer, addr = 0 } = {}) {
+    const W = mu.PACKED_WORDS;
+    const strings = [];
+    let text_len = 0;
+    for (const c of commands) {
+        if (c.type === mu.COMMAND_TEXT) {
+            strings.push(encoder.encode(c.str));
+            text_len += strings[strings.length - 1].length;
+        }
+    }
+    const records = addr;
+    const damage_addr = records + commands.length * W * 4;
+    const text = damage_addr + damage.length * 16;
+    buffer ??= new ArrayBuffer((text + text_len + 3) & ~3);
+    const words = new Int32Array(buffer);
+    const bytes = new Uint8Array(buffer);
+    let offset = 0;
+    commands.forEach((c, i) => {
+        const p = (records >> 2) + i * W;
+        words[p + mu.PACKED_TYPE] = c.type;
+        words[p + mu.PACKED_X] = c.x;
+        words[p + mu.PACKED_Y] = c.y;
+        words[p + mu.PACKED_COLOR] = c.color ?? -1;
+        if (c.type === mu.COMMAND_TEXT) {
+            const s = strings.shift();
+            bytes.set(s, text + offset);
+            words[p + mu.PACKED_TEXT_OFFSET] = offset;
+            words[p + mu.PACKED_TEXT_LEN] = s.length;
+            words[p + mu.PACKED_TEXT_ID] = c.id;
+            words[p + mu.PACKED_TEXT_WIDTH] = c.str.length * 7;
+            offset += s.length;
+        } else {
+            words[p + mu.PACKED_W] = c.w;
+            words[p + mu.PACKED_H] = c.h;
+            words[p + mu.PACKED_ARG0] = c.icon ?? 0;
+        }
+    });
+    damage.forEach((r, i) => words.set(r, (damage_addr >> 2) + i * 4));
+    return {
+        buffer, count: commands.length, records, text, text_generation: 0,
+        hash, damage_base, damage: damage_addr, damage_count: damage.length,
+    };
+}
+
+const RED = 0xff0000ff | 0;
+const scene = [
+    { type: mu.COMMAND_RECT, x: 0, y: 0, w: 100, h: 100, color: RED },
+    { type: mu.COMMAND_CLIP, x: 0, y: 0, w: 50, h: 50 },
+    { type: mu.COMMAND_TEXT, x: 5, y: 5, str: "héllo", id: 1 },
+    { type: mu.COMMAND_ICON, x: 200, y: 200, w: 16, h: 16, icon: mu.ICON_CHECK },
+    { type: mu.COMMAND_RECT, x: 300, y: 300, w: 10, h: 10, color: RED },
+];
+
+function test_painter() {
+    const ctx2d = new StubContext2D();
+    const painter = new FramePainter(ctx2d);
+    assert.equal(painter.paint(make_frame(scene, { hash: 1 }), "#000"), true);
+    // the stub doesn't clip, the last rect is recorded too
+    assert.deepEqual(ctx2d.fills(), ["fillRect(0,0,800,600)", "fillRect(0,0,100,100)", "fillText(héllo,5,15)",
+        "fillRect(300,300,10,10)"]);
+    assert.ok(ctx2d.calls.includes("stroke()"), "icon is drawn");
+
+    // same hash and background: nothing to do
+    ctx2d.calls = [];
+    assert.equal(painter.paint(make_frame(scene, { hash: 1 }), "#000"), false);
+    assert.equal(ctx2d.calls.length, 0);
+
+    // damage relative to the painted frame: only touching commands replay
+    ctx2d.calls = [];
+    const moved = scene.map(c => c.x === 300 ? { ...c, x: 310 } : c);
+    const damage = [[300, 300, 20, 10]];
+    assert.equal(painter.paint(make_frame(moved, { hash: 2, damage_base: 1, damage }), "#000"), true);
+    assert.deepEqual(ctx2d.fills(), ["fillRect(299,299,22,12)", "fillRect(310,300,10,10)"]);
+
+    // glyphs may overhang the measured text box by TEXT_MARGIN, so text next
+    // to a damaged rect is repainted too
+    ctx2d.calls = [];
+    const text = [{ type: mu.COMMAND_TEXT, x: 100, y: 100, str: "ab", id: 2 }];
+    painter.paint(make_frame(text, { hash: 4 }), "#000");
+    ctx2d.calls = [];
+    painter.paint(make_frame(text, { hash: 5, damage_base: 4, damage: [[116, 100, 10, 10]] }), "#000");
+    assert.deepEqual(ctx2d.fills(), ["fillRect(115,99,12,12)", "fillText(ab,100,110)"]);
+
+    // damage relative to another frame: full repaint
+    ctx2d.calls = [];
+    painter.paint(make_frame(scene, { hash: 3, damage_base: 7, damage }), "#000");
+    assert.equal(ctx2d.fills()[0], "fillRect(0,0,800,600)");
+    assert.equal(ctx2d.fills().length, 4);
+}
+
+// two contexts' packers hand out the same string ids in the same generation
+function test_text_tables() {
+    const text = (str) => [{ type: mu.COMMAND_TEXT, x: 0, y: 0, str, id: 1 }];
+    const first = new StubContext2D(), second = new StubContext2D();
+    new FramePainter(first).paint(make_frame(text("first"), { hash: 1 }));
+    new FramePainter(second).paint(make_frame(text("second"), { hash: 2 }));
+    assert.deepEqual(first.fills(), ["fillText(first,0,10)"]);
+    assert.deepEqual(second.fills(), ["fillText(second,0,10)"]);
+}
+
+function test_batching() {
+    const BLUE = 0xffff0000 | 0;
+    const SEE_THROUGH = 0x80ff0000 | 0;
+    const rect = (x, y, w, h, color) => ({ type: mu.COMMAND_RECT, x, y, w, h, color });
+    const frame = make_frame([
+        rect(0, 0, 10, 10, RED),
+        rect(20, 0, 10, 10, BLUE),
+        rect(40, 0, 10, 10, RED),
+        // over the blue one: after it, so in a batch of its own
+        rect(25, 5, 10, 10, RED),
+        { type: mu.COMMAND_TEXT, x: 100, y: 0, str: "a", id: 11, color: BLUE },
+        { type: mu.COMMAND_TEXT, x: 100, y: 20, str: "b", id: 12, color: BLUE },
+        // translucent rects that overlap are never filled as one path
+        rect(200, 0, 10, 10, SEE_THROUGH),
+        rect(205, 0, 10, 10, SEE_THROUGH),
+        { type: mu.COMMAND_CLIP, x: 0, y: 0, w: 50, h: 50 },
+        rect(0, 0, 10, 10, RED),
+    ], { hash: 1 });
+    const ctx2d = new StubContext2D();
+    new FramePainter(ctx2d).paint(frame);
+    const calls = ctx2d.calls.filter(c => c.startsWith("fill") || c.startsWith("rect") || c === "clip()");
+    assert.deepEqual(calls, [
+        "rect(0,0,10,10)", "rect(40,0,10,10)", "fill()",
+        "fillRect(20,0,10,10)",
+        "fillRect(25,5,10,10)",
+        "fillText(a,100,10)", "fillText(b,100,30)",
+        "fillRect(200,0,10,10)",
+        "fillRect(205,0,10,10)",
+        "rect(0,0,50,50)", "clip()",
+        "fillRect(0,0,10,10)",
+    ]);
+}
+
+function test_copy_frame() {
+    // a frame inside a larger buffer, as it would be in WASM memory
+    const frame = make_frame(scene, { hash: 4, damage: [[1, 2, 3, 4]], buffer: new ArrayBuffer(4096), addr: 256 });
+    const copy = copy_frame(frame);
+    assert.equal(copy.records, 0);
+    assert.ok(copy.buffer.byteLength < 4096);
+    assert.deepEqual(Array.from(new Int32Array(copy.buffer, copy.damage, 4)), [1, 2, 3, 4]);
+    const a = new StubContext2D(), b = new StubContext2D();
+    new FramePainter(a).paint(frame, "#fff");
+    new FramePainter(b).paint(copy, "#fff");
+    assert.deepEqual(b.calls, a.calls);
+}
+
+function test_shared_reader() {
+    const memory = new WebAssembly.Memory({ initial: 1, maximum: 1, shared: true });
+    const heap = new Int32Array(memory.buffer);
+    const addr = 1024;
+    Atomics.store(heap, addr >> 2, 2);
+    const reader = new SharedFrameReader(memory, addr);
+    assert.equal(reader.acquire(), null);
+
+    // the producer side of `FrameExchange::publish`
+    let back = 0;
+    function publish(serial, hash) {
+        const h = (addr >> 2) + 1 + back * mu.FRAME_WORDS;
+        const f = make_frame(scene, { hash, buffer: memory.buffer, addr: 8192 * (back + 1) });
+        heap[h + mu.FRAME_SERIAL] = serial;
+        heap[h + mu.FRAME_COUNT] = f.count;
+        heap[h + mu.FRAME_RECORDS] = f.records;
+        heap[h + mu.FRAME_TEXT] = f.text;
+        heap[h + mu.FRAME_HASH] = hash;
+        heap[h + mu.FRAME_DAMAGE_COUNT] = 0;
+        back = Atomics.exchange(heap, addr >> 2, back | mu.FRAME_FRESH) & ~mu.FRAME_FRESH;
+    }
+    publish(1, 11);
+    publish(2, -12);
+    const frame = reader.acquire();
+    assert.equal(frame.serial, 2);
+    assert.equal(frame.hash, -12 >>> 0);
+    assert.equal(reader.acquire(), null);
+    const ctx2d = new StubContext2D();
+    new FramePainter(ctx2d).paint(frame, "#000");
+    assert.equal(ctx2d.fills().length, 4);
+    publish(3, 13);
+    assert.equal(reader.acquire().serial, 3);
+}
+
+async function test_worker() {
+    // the worker module only needs `self.onmessage`
+    globalThis.self = {};
+    await import("../src/render_worker.mjs");
+    const ctx2d = new StubContext2D();
+    self.onmessage({ data: { type: "init", canvas: { getContext: () => ctx2d }, scale: 2 } });
+    assert.deepEqual(ctx2d.calls, ["scale(2,2)"]);
+    for (let i = 0; i < 3; ++i) {
+        const commands = [{ type: mu.COMMAND_TEXT, x: 0, y: 0, str: `frame ${i}`, id: i + 1 }];
+        self.onmessage({ data: { type: "frame", frame: copy_frame(make_frame(commands, { hash: i + 1 })) } });
+    }
+    await new Promise(resolve => setTimeout(resolve, 50));
+    // only the newest frame is painted
+    assert.deepEqual(ctx2d.fills(), ["fillText(frame 2,0,10)"]);
+}
+
+test_painter();
+test_text_tables();
+test_batching();
+test_copy_frame();
+test_shared_reader();
+await test_worker();
+console.log("replay: all passed");
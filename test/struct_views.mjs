@@ -0,0 +1,70 @@
+// Microbenchmark of the embind value object path against the struct views for
+// the same frame: a window of rows, each reading its layout rect and the
+// window rect and drawing a rect. Needs `npm run build:wasm`, then run with
+// `node test/struct_views.mjs [FRAMES]`.
+
+import { microui, StructViews } from "../src/index.mjs";
+
+const frames = Number(process.argv[2] ?? 2000);
+const ROWS = 200;
+
+function new_context() {
+    const mctx = new microui.Context();
+    mctx.set_text_width_callback(microui.addFunction((_, text, len) => (len < 0 ? 8 : len) * 7, "iiii"));
+    mctx.set_text_height_callback(microui.addFunction(_ => 14, "ii"));
+    return mctx;
+}
+
+function embind_frame(mctx) {
+    let sum = 0;
+    mctx.begin();
+    if (mctx.begin_window("Bench", { x: 10, y: 10, w: 400, h: 300 })) {
+        const win = mctx.get_current_container();
+        for (let i = 0; i < ROWS; ++i) {
+            const r = mctx.layout_next();
+            sum += r.w + win.rect.x;
+            mctx.draw_rect(r, { r: i & 255, g: 0, b: 0, a: 255 });
+        }
+        mctx.end_window();
+    }
+    mctx.end();
+    return sum;
+}
+
+function views_frame(mctx, views) {
+    let sum = 0;
+    mctx.begin();
+    if (views.begin_window("Bench", 10, 10, 400, 300)) {
+        const win = views.current_container();
+        for (let i = 0; i < ROWS; ++i) {
+            const r = views.layout_next();
+            const w = r.w;
+            sum += w + win.rect.x;
+            views.draw_rect(r.x, r.y, w, r.h, i & 255, 0, 0);
+        }
+        mctx.end_window();
+    }
+    mctx.end();
+    return sum;
+}
+
+function run(name, frame) {
+    // warm up the JIT and the retained state
+    let sum = 0;
+    for (let i = 0; i < frames / 10; ++i)
+        sum += frame();
+    const t0 = performance.now();
+    for (let i = 0; i < frames; ++i)
+        sum += frame();
+    const us = (performance.now() - t0) * 1000 / frames;
+    console.log(`${name.padEnd(8)} ${us.toFixed(1).padStart(10)} us/frame`);
+    return sum;
+}
+
+const a = new_context(), b = new_context();
+const views = new StructViews(b);
+const sums = [run("embind", () => embind_frame(a)), run("views", () => views_frame(b, views))];
+if (sums[0] !== sums[1])
+    throw new Error(`the paths disagree: ${sums[0]} != ${sums[1]}`);
+a.delete();
+b.delete();
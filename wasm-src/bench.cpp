@@ -0,0 +1,771 @@
+// Headless frame benchmark, built natively by `make bench`.
+//
+// Replays scripted scenes against `microui.c` with stub text callbacks and
+// reports the time per frame, the number of commands per frame and the bytes
+// of command list used. Results are also written as JSON so runs can be
+// compared over time.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "microui.h"
+}
+
+#include "frame_program.h"
+#include "packed_commands.h"
+#include "raster.h"
+#include "text_width_cache.h"
+
+static int stub_text_width(mu_Font, const char *str, int len) {
+    if (len < 0)
+        len = strlen(str);
+    return len * 7;
+}
+
+static int stub_text_height(mu_Font) {
+    return 14;
+}
+
+/*============================================================================
+** scenes
+**============================================================================*/
+
+struct SceneState {
+    float bg[3] = {90, 95, 100};
+    int checks[3] = {1, 0, 1};
+    char textbox[128] = "";
+    std::string log;
+    float sliders[64] = {};
+};
+
+static void demo_scene(mu_Context *ctx, SceneState &st) {
+    // mirrors demo/demo.js
+    if (mu_begin_window(ctx, "Demo Window", mu_rect(40, 40, 300, 450))) {
+        if (mu_header(ctx, "Window Info")) {
+            mu_Container *win = mu_get_current_container(ctx);
+            char buf[64];
+            int widths[] = {54, -1};
+            mu_layout_row(ctx, 2, widths, 0);
+            mu_label(ctx, "Position:");
+            snprintf(buf, sizeof(buf), "%d, %d", win->rect.x, win->rect.y);
+            mu_label(ctx, buf);
+            mu_label(ctx, "Size:");
+            snprintf(buf, sizeof(buf), "%d, %d", win->rect.w, win->rect.h);
+            mu_label(ctx, buf);
+        }
+        if (mu_header_ex(ctx, "Test Buttons", MU_OPT_EXPANDED)) {
+            int widths[] = {86, -110, -1};
+            mu_layout_row(ctx, 3, widths, 0);
+            mu_label(ctx, "Test buttons 1:");
+            if (mu_button(ctx, "Button 1"))
+                st.log += "Pressed button 1\n";
+            if (mu_button(ctx, "Button 2"))
+                st.log += "Pressed button 2\n";
+            mu_label(ctx, "Test buttons 2:");
+            if (mu_button(ctx, "Button 3"))
+                st.log += "Pressed button 3\n";
+            if (mu_button(ctx, "Popup"))
+                mu_open_popup(ctx, "Test Popup");
+            if (mu_begin_popup(ctx, "Test Popup")) {
+                mu_button(ctx, "Hello");
+                mu_button(ctx, "World");
+                mu_end_popup(ctx);
+            }
+        }
+        if (mu_header_ex(ctx, "Tree and Text", MU_OPT_EXPANDED)) {
+            int widths[] = {140, -1};
+            mu_layout_row(ctx, 2, widths, 0);
+            mu_layout_begin_column(ctx);
+            if (mu_begin_treenode(ctx, "Test 1")) {
+                if (mu_begin_treenode(ctx, "Test 1a")) {
+                    mu_label(ctx, "Hello");
+                    mu_label(ctx, "world");
+                    mu_end_treenode(ctx);
+                }
+                if (mu_begin_treenode(ctx, "Test 1b")) {
+                    mu_button(ctx, "Button 1");
+                    mu_button(ctx, "Button 2");
+                    mu_end_treenode(ctx);
+                }
+                mu_end_treenode(ctx);
+            }
+            if (mu_begin_treenode(ctx, "Test 3")) {
+                mu_checkbox(ctx, "Checkbox 1", &st.checks[0]);
+                mu_checkbox(ctx, "Checkbox 2", &st.checks[1]);
+                mu_checkbox(ctx, "Checkbox 3", &st.checks[2]);
+                mu_end_treenode(ctx);
+            }
+            mu_layout_end_column(ctx);
+            mu_layout_begin_column(ctx);
+            int full[] = {-1};
+            mu_layout_row(ctx, 1, full, 0);
+            mu_text(ctx, "Lorem ipsum dolor sit amet, consectetur adipiscing "
+                         "elit. Maecenas lacinia, sem eu lacinia molestie, mi risus faucibus "
+                         "ipsum, eu varius magna felis a nulla.");
+            mu_layout_end_column(ctx);
+        }
+        if (mu_header_ex(ctx, "Background Color", MU_OPT_EXPANDED)) {
+            int widths[] = {-78, -1};
+            mu_layout_row(ctx, 2, widths, 74);
+            mu_layout_begin_column(ctx);
+            int sliders[] = {46, -1};
+            mu_layout_row(ctx, 2, sliders, 0);
+            mu_label(ctx, "Red:");
+            mu_slider(ctx, &st.bg[0], 0, 255);
+            mu_label(ctx, "Green:");
+            mu_slider(ctx, &st.bg[1], 0, 255);
+            mu_label(ctx, "Blue:");
+            mu_slider(ctx, &st.bg[2], 0, 255);
+            mu_layout_end_column(ctx);
+            mu_Rect r = mu_layout_next(ctx);
+            mu_draw_rect(ctx, r, mu_color(st.bg[0], st.bg[1], st.bg[2], 255));
+            mu_draw_control_text(ctx, "#5A5F64", r, MU_COLOR_TEXT, MU_OPT_ALIGNCENTER);
+        }
+        mu_end_window(ctx);
+    }
+
+    if (mu_begin_window(ctx, "Log Window", mu_rect(350, 40, 300, 200))) {
+        int full[] = {-1};
+        mu_layout_row(ctx, 1, full, -25);
+        mu_begin_panel(ctx, "Log Output");
+        mu_layout_row(ctx, 1, full, -1);
+        mu_text(ctx, st.log.c_str());
+        mu_end_panel(ctx);
+        int widths[] = {-70, -1};
+        mu_layout_row(ctx, 2, widths, 0);
+        mu_textbox(ctx, st.textbox, sizeof(st.textbox));
+        mu_button(ctx, "Submit");
+        mu_end_window(ctx);
+    }
+
+    if (mu_begin_window(ctx, "Style Editor", mu_rect(350, 250, 300, 240))) {
+        int sw = mu_get_current_container(ctx)->body.w * 0.14;
+        int widths[] = {80, sw, sw, sw, sw, -1};
+        mu_layout_row(ctx, 6, widths, 0);
+        for (int i = 0; i < MU_COLOR_MAX; ++i) {
+            mu_label(ctx, "color:");
+            for (int j = 0; j < 4; ++j) {
+                float *v = &st.sliders[(i * 4 + j) % 64];
+                mu_push_id(ctx, &v, sizeof(v));
+                mu_slider_ex(ctx, v, 0, 255, 0, "%.0f", MU_OPT_ALIGNCENTER);
+                mu_pop_id(ctx);
+            }
+            mu_draw_rect(ctx, mu_layout_next(ctx), ctx->style->colors[i]);
+        }
+        mu_end_window(ctx);
+    }
+}
+
+static void list_scene(mu_Context *ctx, SceneState &) {
+    if (mu_begin_window(ctx, "List", mu_rect(10, 10, 500, 580))) {
+        int widths[] = {60, -80, -1};
+        mu_layout_row(ctx, 3, widths, 0);
+        for (int i = 0; i < 1000; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%d", i);
+            mu_label(ctx, buf);
+            mu_push_id(ctx, &i, sizeof(i));
+            mu_label(ctx, "some row text");
+            mu_button(ctx, "Edit");
+            mu_pop_id(ctx);
+        }
+        mu_end_window(ctx);
+    }
+}
+
+// the same rows as `list_scene`, a hundred times more of them, laid out lazily
+static void virtual_list_scene(mu_Context *ctx, SceneState &) {
+    if (mu_begin_window(ctx, "List", mu_rect(10, 10, 500, 580))) {
+        int widths[] = {60, -80, -1};
+        mu_layout_row(ctx, 3, widths, 0);
+        mu_VirtualList list;
+        mu_begin_virtual_list(ctx, &list, 100000, 0);
+        for (int i = list.first; i < list.last; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "%d", i);
+            mu_label(ctx, buf);
+            mu_push_id(ctx, &i, sizeof(i));
+            mu_label(ctx, "some row text");
+            mu_button(ctx, "Edit");
+            mu_pop_id(ctx);
+        }
+        mu_end_virtual_list(ctx, &list);
+        mu_end_window(ctx);
+    }
+}
+
+// a log panel that starts at 8 KB and grows by a line every few frames
+static void log_scene(mu_Context *ctx, SceneState &st) {
+    if (st.log.empty()) {
+        for (int i = 0; i < 200; ++i)
+            st.log += "[info] request " + std::to_string(i) + " handled in a few ms\n";
+    }
+    if (ctx->frame % 4 == 0)
+        st.log += "[info] request " + std::to_string(ctx->frame) + " handled in a few ms\n";
+    if (mu_begin_window(ctx, "Log Window", mu_rect(10, 10, 500, 580))) {
+        int full[] = {-1};
+        mu_layout_row(ctx, 1, full, -1);
+        mu_begin_panel(ctx, "Log Output");
+        mu_layout_row(ctx, 1, full, -1);
+        mu_text(ctx, st.log.c_str());
+        mu_end_panel(ctx);
+        mu_end_window(ctx);
+    }
+}
+
+static void tree_level(mu_Context *ctx, int depth) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "Node %d", depth);
+    if (depth < 24 && mu_begin_treenode_ex(ctx, buf, MU_OPT_EXPANDED)) {
+        mu_label(ctx, "leaf");
+        tree_level(ctx, depth + 1);
+        mu_end_treenode(ctx);
+    }
+}
+
+static void tree_scene(mu_Context *ctx, SceneState &) {
+    if (mu_begin_window(ctx, "Tree", mu_rect(10, 10, 780, 580))) {
+        tree_level(ctx, 0);
+        mu_end_window(ctx);
+    }
+}
+
+// a flat outline with a raised treenode pool, every header looks itself up
+static void outline_scene(mu_Context *ctx, SceneState &) {
+    if (mu_begin_window(ctx, "Outline", mu_rect(10, 10, 780, 580))) {
+        for (int i = 0; i < 2000; ++i) {
+            char buf[32];
+            snprintf(buf, sizeof(buf), "Section %d", i);
+            if (mu_header_ex(ctx, buf, i % 4 ? 0 : MU_OPT_EXPANDED))
+                mu_label(ctx, "body");
+        }
+        mu_end_window(ctx);
+    }
+}
+
+static void windows_scene(mu_Context *ctx, SceneState &st) {
+    for (int i = 0; i < 24; ++i) {
+        char title[32];
+        snprintf(title, sizeof(title), "Window %d", i);
+        if (mu_begin_window(ctx, title, mu_rect(10 + (i % 6) * 120, 10 + (i / 6) * 140, 150, 160))) {
+            int widths[] = {-1};
+            mu_layout_row(ctx, 1, widths, 0);
+            mu_label(ctx, title);
+            mu_button(ctx, "Button");
+            mu_slider(ctx, &st.sliders[i], 0, 100);
+            mu_end_window(ctx);
+        }
+    }
+}
+
+// hundreds of small overlapping windows, clicks keep reordering them
+static void floating_scene(mu_Context *ctx, SceneState &) {
+    for (int i = 0; i < 200; ++i) {
+        char title[32];
+        snprintf(title, sizeof(title), "Float %d", i);
+        int x = (i * 97) % 700, y = (i * 61) % 520;
+        if (mu_begin_window(ctx, title, mu_rect(x, y, 90, 70))) {
+            mu_label(ctx, title);
+            mu_end_window(ctx);
+        }
+    }
+}
+
+// a settings form with long, static labels, so the id hash dominates the frame
+static void long_form_scene(mu_Context *ctx, SceneState &st) {
+    static std::vector<std::string> labels;
+    if (labels.empty()) {
+        for (int i = 0; i < 400; ++i)
+            labels.push_back("Send a notification to the account owner when order #" + std::to_string(i) +
+                             " has shipped");
+    }
+    if (mu_begin_window(ctx, "Notification Settings", mu_rect(10, 10, 780, 580))) {
+        int widths[] = {-90, -1};
+        mu_layout_row(ctx, 2, widths, 0);
+        for (size_t i = 0; i < labels.size(); ++i) {
+            mu_checkbox(ctx, labels[i].c_str(), &st.checks[i % 3]);
+            mu_push_id(ctx, &i, sizeof(i));
+            mu_button(ctx, "Send a test message now");
+            mu_pop_id(ctx);
+        }
+        mu_end_window(ctx);
+    }
+}
+
+// `long_form` with the labels hashed and measured once, as `intern` does
+static void form_hashed_scene(mu_Context *ctx, SceneState &st) {
+    static std::vector<std::string> strings;
+    static std::vector<mu_HashedLabel> labels;
+    static mu_HashedLabel title, send;
+    if (strings.empty()) {
+        for (int i = 0; i < 400; ++i)
+            strings.push_back("Send a notification to the account owner when order #" + std::to_string(i) +
+                              " has shipped");
+        for (const std::string &s : strings)
+            labels.push_back(mu_hashed_label(s.c_str(), s.size()));
+        title = mu_hashed_label("Notification Settings", -1);
+        send = mu_hashed_label("Send a test message now", -1);
+    }
+    if (mu_begin_window_hashed(ctx, &title, mu_rect(10, 10, 780, 580), 0)) {
+        int widths[] = {-90, -1};
+        mu_layout_row(ctx, 2, widths, 0);
+        for (size_t i = 0; i < labels.size(); ++i) {
+            mu_checkbox_hashed(ctx, &labels[i], &st.checks[i % 3]);
+            mu_push_id(ctx, &i, sizeof(i));
+            mu_button_hashed(ctx, &send, 0, MU_OPT_ALIGNCENTER);
+            mu_pop_id(ctx);
+        }
+        mu_end_window(ctx);
+    }
+}
+
+struct Scene {
+    const char *name;
+    void (*run)(mu_Context *ctx, SceneState &st);
+    // clicking would collapse the tree, only hover that one
+    bool clicks;
+    // 0 keeps the default
+    int treenode_pool;
+    int container_pool;
+};
+
+static const Scene scenes[] = {
+    {"demo", demo_scene, true},
+    {"list_1k", list_scene, true},
+    {"vlist_100k", virtual_list_scene, true},
+    {"log", log_scene, true},
+    {"deep_tree", tree_scene, false},
+    {"many_windows", windows_scene, true},
+    {"outline", outline_scene, true, 4096},
+    {"floating_200", floating_scene, true, 0, 256},
+    {"long_form", long_form_scene, true},
+    {"form_hashed", form_hashed_scene, true},
+};
+
+/*============================================================================
+** driver
+**============================================================================*/
+
+struct Result {
+    const char *scene;
+    int frames;
+    double ns_per_frame;
+    double pack_ns_per_frame;
+    double raster_ns_per_frame;
+    double optimize_ns_per_frame;
+    int commands;
+    // packed records left by `CommandPacker::optimize` on the last frame
+    int optimized;
+    int command_bytes;
+};
+
+static int command_count(mu_Context *ctx) {
+    int n = 0;
+    mu_Command *cmd = NULL;
+    while (mu_next_command(ctx, &cmd))
+        ++n;
+    return n;
+}
+
+// moves the mouse over the screen and clicks every 30 frames, so hover and
+// focus keep changing like they would with a user
+static void scripted_input(mu_Context *ctx, int frame, bool clicks) {
+    int x = (frame * 7) % 800;
+    int y = (frame * 3) % 600;
+    mu_input_mousemove(ctx, x, y);
+    if (!clicks)
+        return;
+    if (frame % 30 == 10)
+        mu_input_mousedown(ctx, x, y, MU_MOUSE_LEFT);
+    if (frame % 30 == 12)
+        mu_input_mouseup(ctx, x, y, MU_MOUSE_LEFT);
+}
+
+// binary PPM of the framebuffer, alpha dropped
+static bool write_ppm(const char *path, const Rasterizer &raster) {
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        perror(path);
+        return false;
+    }
+    fprintf(fp, "P6\n%d %d\n255\n", raster.width(), raster.height());
+    const uint8_t *px = raster.pixels();
+    for (int i = 0; i < raster.width() * raster.height(); ++i)
+        fwrite(px + i * 4, 1, 3, fp);
+    fclose(fp);
+    return true;
+}
+
+static Result run_scene(const Scene &scene, int frames, const char *ppm_prefix) {
+    using clock = std::chrono::steady_clock;
+    mu_Context *ctx = new mu_Context;
+    mu_Capacity cap = {};
+    cap.treenode_pool = scene.treenode_pool;
+    cap.container_pool = scene.container_pool;
+    mu_init_ex(ctx, &cap);
+    ctx->text_width = stub_text_width;
+    ctx->text_height = stub_text_height;
+    SceneState st;
+    CommandPacker packer;
+    Rasterizer raster;
+    raster.resize(800, 600);
+
+    Result res = {scene.name, frames, 0, 0, 0, 0, 0, 0, 0};
+    // warm up the retained state (pools, z-order, content sizes)
+    int warmup = frames / 10 + 1;
+    clock::duration ui_time{}, pack_time{}, raster_time{}, optimize_time{};
+    for (int i = 0; i < warmup + frames; ++i) {
+        scripted_input(ctx, i, scene.clicks);
+        clock::time_point t0 = clock::now();
+        mu_begin(ctx);
+        scene.run(ctx, st);
+        mu_end(ctx);
+        clock::time_point t1 = clock::now();
+        packer.pack(ctx);
+        clock::time_point t2 = clock::now();
+        raster.clear(mu_color(90, 95, 100, 255));
+        raster.draw(ctx);
+        clock::time_point t3 = clock::now();
+        res.optimized = packer.optimize(ctx);
+        clock::time_point t4 = clock::now();
+        if (i >= warmup) {
+            ui_time += t1 - t0;
+            pack_time += t2 - t1;
+            raster_time += t3 - t2;
+            optimize_time += t4 - t3;
+        }
+    }
+    res.ns_per_frame = std::chrono::duration<double, std::nano>(ui_time).count() / frames;
+    res.pack_ns_per_frame = std::chrono::duration<double, std::nano>(pack_time).count() / frames;
+    res.raster_ns_per_frame = std::chrono::duration<double, std::nano>(raster_time).count() / frames;
+    res.optimize_ns_per_frame = std::chrono::duration<double, std::nano>(optimize_time).count() / frames;
+    if (ppm_prefix) {
+        std::string path = std::string(ppm_prefix) + scene.name + ".ppm";
+        write_ppm(path.c_str(), raster);
+    }
+    res.commands = command_count(ctx);
+    res.command_bytes = ctx->command_list.idx;
+    mu_deinit(ctx);
+    delete ctx;
+    return res;
+}
+
+static void write_json(FILE *fp, const std::vector<Result> &results) {
+    fputs("[\n", fp);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result &r = results[i];
+        fprintf(fp,
+                "  {\"scene\": \"%s\", \"frames\": %d, \"ns_per_frame\": %.1f, \"pack_ns_per_frame\": %.1f, "
+                "\"raster_ns_per_frame\": %.1f, \"optimize_ns_per_frame\": %.1f, \"commands_per_frame\": %d, "
+                "\"optimized_records\": %d, \"command_bytes\": %d}%s\n",
+                r.scene, r.frames, r.ns_per_frame, r.pack_ns_per_frame, r.raster_ns_per_frame, r.optimize_ns_per_frame,
+                r.commands, r.optimized, r.command_bytes,
+                i + 1 < results.size() ? "," : "");
+    }
+    fputs("]\n", fp);
+}
+
+/*============================================================================
+** id hash
+**============================================================================*/
+
+// `mu_hash_id` throughput over labels of a few lengths, then the collisions
+// among ids over generated label sets against what a uniform 32bit hash
+// would give. build `bench-fnv` for the byte-at-a-time FNV-1a numbers
+static void hash_benchmark() {
+    using clock = std::chrono::steady_clock;
+    printf("%-14s %12s %12s\n", "label bytes", "ns/hash", "MB/s");
+    const int lens[] = {8, 16, 32, 64, 128};
+    for (int len : lens) {
+        // a few distinct labels so the loop can't fold to a constant
+        std::vector<std::string> labels;
+        for (int i = 0; i < 16; ++i) {
+            std::string l;
+            for (int j = 0; j < len; ++j)
+                l += (char)('a' + (i * 7 + j * 13) % 26);
+            labels.push_back(l);
+        }
+        const int calls = 4000000;
+        mu_Id sink = 0;
+        clock::time_point t0 = clock::now();
+        for (int i = 0; i < calls; ++i) {
+            const std::string &l = labels[i & 15];
+            sink ^= mu_hash_id(l.data(), l.size());
+        }
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - t0).count() / calls;
+        printf("%-14d %12.2f %12.0f%s\n", len, ns, len / ns * 1000, sink == 1 ? " " : "");
+    }
+
+    mu_Context *ctx = new mu_Context;
+    mu_init(ctx);
+    std::vector<mu_Id> ids;
+    auto collisions = [&ids](const char *set) {
+        size_t n = ids.size();
+        std::sort(ids.begin(), ids.end());
+        size_t dup = 0;
+        for (size_t i = 1; i < n; ++i)
+            dup += ids[i] == ids[i - 1];
+        double expected = (double)n * (n - 1) / 2 / 4294967296.0;
+        printf("%-26s %10zu ids %8zu collisions (uniform: %.0f)\n", set, n, dup, expected);
+        ids.clear();
+    };
+    char buf[64];
+    for (int i = 0; i < (1 << 20); ++i) {
+        int len = snprintf(buf, sizeof(buf), "Button %d", i);
+        ids.push_back(mu_hash_id(buf, len));
+    }
+    collisions("\"Button N\"");
+    for (int i = 0; i < (1 << 20); ++i) {
+        int len = snprintf(buf, sizeof(buf), "Send a notification when order #%d has shipped", i);
+        ids.push_back(mu_hash_id(buf, len));
+    }
+    collisions("long labels");
+    // the same 1024 labels inside 1024 windows, chained through the id stack
+    for (int w = 0; w < 1024; ++w) {
+        int len = snprintf(buf, sizeof(buf), "Window %d", w);
+        mu_push_id(ctx, buf, len);
+        for (int b = 0; b < 1024; ++b) {
+            len = snprintf(buf, sizeof(buf), "Item %d", b);
+            ids.push_back(mu_get_id(ctx, buf, len));
+        }
+        mu_pop_id(ctx);
+    }
+    collisions("nested \"Item N\"");
+    // 4-byte keys, like `mu_push_id` on an int or a pointer
+    for (int i = 0; i < (1 << 20); ++i)
+        ids.push_back(mu_hash_id(&i, sizeof(i)));
+    collisions("int keys");
+    mu_deinit(ctx);
+    delete ctx;
+}
+
+/*============================================================================
+** frame programs
+**============================================================================*/
+
+// the direct calls that test/frame_program.mjs encodes with `FrameBuilder`.
+// nothing takes a pointer, those are wasm32 addresses in a program
+static void frame_program_reference(mu_Context *ctx) {
+    if (mu_begin_window(ctx, "Frame Program", mu_rect(10, 10, 300, 400))) {
+        if (mu_header_ex(ctx, "Buttons", MU_OPT_EXPANDED)) {
+            int widths[] = {100, -1};
+            mu_layout_row(ctx, 2, widths, 0);
+            mu_button(ctx, "Button 1");
+            mu_button(ctx, "Button 2");
+        }
+        if (mu_header(ctx, "Closed"))
+            mu_label(ctx, "hidden");
+        if (mu_begin_treenode_ex(ctx, "Tree", MU_OPT_EXPANDED)) {
+            int id = 42;
+            mu_push_id(ctx, &id, sizeof(id));
+            mu_label(ctx, "leaf");
+            mu_button_ex(ctx, NULL, MU_ICON_CHECK, 0);
+            mu_pop_id(ctx);
+            mu_end_treenode(ctx);
+        }
+        int widths[] = {140, -1};
+        mu_layout_row(ctx, 2, widths, 60);
+        mu_layout_begin_column(ctx);
+        mu_label(ctx, "column");
+        mu_layout_end_column(ctx);
+        mu_begin_panel(ctx, "Panel");
+        mu_text(ctx, "leaf");
+        mu_end_panel(ctx);
+        mu_end_window(ctx);
+    }
+}
+
+static std::vector<char> command_bytes(mu_Context *ctx) {
+    std::vector<char> res;
+    mu_Command *cmd = NULL;
+    while (mu_next_command(ctx, &cmd))
+        res.insert(res.end(), (char *)cmd, (char *)cmd + cmd->base.size);
+    return res;
+}
+
+// reads a label count, that many lines of labels and then the program's
+// words from stdin. prints "rejected" (exit 2) if `run_frame_program` turns
+// the program down, otherwise runs it for `frames` frames of scripted input
+// next to `frame_program_reference` and prints "match" and the last frame's
+// results (exit 0) or where the command lists or results differ (exit 1)
+static int check_frame_program(int frames) {
+    int label_count = 0;
+    if (scanf("%d ", &label_count) != 1 || label_count < 0)
+        return fputs("bad label count\n", stderr), 1;
+    std::vector<std::string> strings(label_count);
+    for (std::string &str : strings) {
+        char line[256];
+        if (!fgets(line, sizeof(line), stdin))
+            return fputs("missing label\n", stderr), 1;
+        str = line;
+        if (!str.empty() && str.back() == '\n')
+            str.pop_back();
+    }
+    std::vector<mu_HashedLabel> labels;
+    for (const std::string &str : strings)
+        labels.push_back(mu_hashed_label(str.c_str(), str.size()));
+    std::vector<int32_t> code;
+    int word;
+    while (scanf("%d", &word) == 1)
+        code.push_back(word);
+
+    mu_Context *a = new mu_Context, *b = new mu_Context;
+    for (mu_Context *ctx : {a, b}) {
+        mu_init(ctx);
+        ctx->text_width = stub_text_width;
+        ctx->text_height = stub_text_height;
+    }
+    int32_t results[16];
+    int res = 0;
+    for (int i = 0; i < frames && res == 0; ++i) {
+        scripted_input(a, i, true);
+        scripted_input(b, i, true);
+        if (run_frame_program(a, code.data(), code.size(), {labels.data(), label_count}, results, 16) != 0) {
+            puts("rejected");
+            res = 2;
+            break;
+        }
+        mu_begin(b);
+        frame_program_reference(b);
+        mu_end(b);
+        if (command_bytes(a) != command_bytes(b)) {
+            printf("commands differ at frame %d\n", i);
+            res = 1;
+        }
+    }
+    if (res == 0) {
+        // the program's window, headers and treenode against the reference
+        printf("match");
+        for (int r : results)
+            printf(" %d", r);
+        putchar('\n');
+    }
+    for (mu_Context *ctx : {a, b}) {
+        mu_deinit(ctx);
+        delete ctx;
+    }
+    return res;
+}
+
+/*============================================================================
+** text width cache
+**============================================================================*/
+
+static int wide_text_width(mu_Font, const char *str, int len) {
+    if (len < 0)
+        len = strlen(str);
+    return len * 9;
+}
+
+static int tall_text_height(mu_Font) {
+    return 20;
+}
+
+#define CHECK(cond)                                                                                                    \
+    if (!(cond))                                                                                                       \
+        return fprintf(stderr, "text width cache: %s failed\n", #cond), 1;
+
+// sets callbacks before and after `install_text_width_cache`, then deletes the
+// context the way the binder does. prints "ok" (exit 0) if the cache measured
+// with the latest callbacks and no `CachedFont` outlived its context
+static int check_text_width_cache() {
+    mu_Context *ctx = new mu_Context;
+    mu_init(ctx);
+    set_text_width_callback(ctx, stub_text_width);
+    set_text_height_callback(ctx, stub_text_height);
+    install_text_width_cache(ctx);
+    CHECK(ctx->text_width(ctx->style->font, "abcd", 4) == 28);
+    CHECK(ctx->text_height(ctx->style->font) == 14);
+    unsigned epoch = ctx->text_epoch;
+    set_text_width_callback(ctx, wide_text_width);
+    set_text_height_callback(ctx, tall_text_height);
+    CHECK(ctx->text_width == cached_text_width);
+    CHECK(ctx->text_epoch != epoch);
+    CHECK(ctx->text_width(ctx->style->font, "abcd", 4) == 36);
+    CHECK(ctx->text_height(ctx->style->font) == 20);
+    CHECK(CachedFont::count() == 1);
+    release_text_width_cache(ctx);
+    mu_deinit(ctx);
+    delete ctx;
+    CHECK(CachedFont::count() == 0);
+    puts("ok");
+    return 0;
+}
+
+#undef CHECK
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--frames N] [--json FILE] [--ppm PREFIX] [--hash] [--frame-program] [--text-width-cache] [SCENE...]\nscenes:", argv0);
+    for (const Scene &s : scenes)
+        fprintf(stderr, " %s", s.name);
+    fputc('\n', stderr);
+}
+
+int main(int argc, char **argv) {
+    int frames = 2000;
+    const char *json_path = NULL;
+    // the last frame of each scene is written to PREFIX<scene>.ppm
+    const char *ppm_prefix = NULL;
+    std::vector<const Scene *> selected;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            json_path = argv[++i];
+        } else if (strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+            ppm_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--hash") == 0) {
+            hash_benchmark();
+            return 0;
+        } else if (strcmp(argv[i], "--frame-program") == 0) {
+            return check_frame_program(120);
+        } else if (strcmp(argv[i], "--text-width-cache") == 0) {
+            return check_text_width_cache();
+        } else {
+            const Scene *found = NULL;
+            for (const Scene &s : scenes)
+                if (strcmp(s.name, argv[i]) == 0)
+                    found = &s;
+            if (!found) {
+                usage(argv[0]);
+                return 1;
+            }
+            selected.push_back(found);
+        }
+    }
+    if (frames <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (selected.empty())
+        for (const Scene &s : scenes)
+            selected.push_back(&s);
+
+    std::vector<Result> results;
+    printf("%-14s %12s %12s %12s %10s %10s %10s %10s\n", "scene", "ns/frame", "pack ns", "raster ns", "opt ns",
+           "commands", "optimized", "bytes");
+    for (const Scene *s : selected) {
+        Result r = run_scene(*s, frames, ppm_prefix);
+        printf("%-14s %12.0f %12.0f %12.0f %10.0f %10d %10d %10d\n", r.scene, r.ns_per_frame, r.pack_ns_per_frame,
+               r.raster_ns_per_frame, r.optimize_ns_per_frame, r.commands, r.optimized, r.command_bytes);
+        results.push_back(r);
+    }
+
+    if (json_path) {
+        FILE *fp = fopen(json_path, "w");
+        if (!fp) {
+            perror(json_path);
+            return 1;
+        }
+        write_json(fp, results);
+        fclose(fp);
+    }
+    return 0;
+}
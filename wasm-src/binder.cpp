@@ -1,32 +1,147 @@
+#include <cstddef>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <emscripten/bind.h>
 #include <emscripten/val.h>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 extern "C" {
 #include "microui.h"
 }
 
-static mu_Context *my_new_mu_Context() {
-    mu_Context *ctx = new mu_Context;
+#include "frame_exchange.h"
+#include "frame_program.h"
+#include "packed_commands.h"
+#include "raster.h"
+#include "text_width_cache.h"
+
+// every context from JS is the first member of one of these, so that contexts
+// used on different threads don't share the buffers their frames are packed
+// and published through
+struct BoundContext {
+    mu_Context ctx;
+    CommandPacker *packer;
+    // created by the first `publish_frame` or `frame_exchange_addr`
+    FrameExchange *exchange;
+};
+
+static_assert(std::is_standard_layout<BoundContext>::value, "a mu_Context* must point to its BoundContext");
+
+static BoundContext *bound(const mu_Context *ctx) {
+    return (BoundContext *)ctx;
+}
+
+static CommandPacker &packer_of(const mu_Context *ctx) {
+    return *bound(ctx)->packer;
+}
+
+static FrameExchange &exchange_of(const mu_Context *ctx) {
+    BoundContext *b = bound(ctx);
+    if (!b->exchange)
+        b->exchange = new FrameExchange;
+    return *b->exchange;
+}
+
+static void my_delete_mu_Context(mu_Context *ctx) {
+    BoundContext *b = bound(ctx);
+    release_text_width_cache(ctx);
+    mu_deinit(ctx);
+    delete b->packer;
+    delete b->exchange;
+    delete b;
+}
+
+static mu_Context *new_bound_context() {
+    BoundContext *b = new BoundContext;
+    b->packer = new CommandPacker;
+    b->exchange = NULL;
+    return &b->ctx;
+}
+
+// held through a `shared_ptr` so that `delete()` from JS also frees the
+// context's block and command list chunks
+static std::shared_ptr<mu_Context> my_new_mu_Context() {
+    mu_Context *ctx = new_bound_context();
     mu_init(ctx);
-    return ctx;
+    return std::shared_ptr<mu_Context>(ctx, my_delete_mu_Context);
+}
+
+static int capacity_field(const emscripten::val &options, const char *name) {
+    emscripten::val v = options[name];
+    return v.isUndefined() ? 0 : v.as<int>();
+}
+
+// `options` is a `mu_Capacity`-like object, e.g. `{ command_bytes: 4096,
+// container_pool: 4 }`; missing fields keep their defaults
+static std::shared_ptr<mu_Context> my_new_mu_Context_ex(emscripten::val options) {
+    mu_Capacity cap;
+    cap.command_bytes = capacity_field(options, "command_bytes");
+    cap.command_limit = capacity_field(options, "command_limit");
+    cap.root_list = capacity_field(options, "root_list");
+    cap.container_stack = capacity_field(options, "container_stack");
+    cap.clip_stack = capacity_field(options, "clip_stack");
+    cap.id_stack = capacity_field(options, "id_stack");
+    cap.layout_stack = capacity_field(options, "layout_stack");
+    cap.container_pool = capacity_field(options, "container_pool");
+    cap.treenode_pool = capacity_field(options, "treenode_pool");
+    cap.input_queue = capacity_field(options, "input_queue");
+    mu_Context *ctx = new_bound_context();
+    mu_init_ex(ctx, &cap);
+    return std::shared_ptr<mu_Context>(ctx, my_delete_mu_Context);
+}
+
+// bytes owned by the context, including grown command list chunks and the
+// damage tracking summaries
+static int my_mu_memory_footprint(const mu_Context &ctx) {
+    int res = sizeof(mu_Context) + ctx.block_size + ctx.command_list.capacity - ctx.command_list.first->size +
+              (ctx.damage.cmd_capacity + ctx.damage.prev_cmd_capacity) * sizeof(mu_DamageCmd);
+    for (const mu_TextLayout &tl : ctx.text_layouts)
+        res += tl.text_capacity + tl.line_capacity * sizeof(mu_TextLine);
+    return res;
+}
+
+static void my_mu_set_command_list_limit(mu_Context &ctx, int limit) {
+    ctx.command_list.limit = limit;
+}
+
+static int my_mu_command_list_overflow(const mu_Context &ctx) {
+    return ctx.command_list.overflow;
+}
+
+static int my_mu_command_list_capacity(const mu_Context &ctx) {
+    return ctx.command_list.capacity;
 }
 
 static std::string my_mu_cmd_text_str(const mu_Command &cmd) {
     return cmd.text.str;
 }
 
+// with `enable_text_width_cache` the cache keeps wrapping the new callback
 static void my_set_text_width_callback(mu_Context *ctx, intptr_t callback) {
-    ctx->text_width = (int (*)(mu_Font, const char *, int))callback;
+    set_text_width_callback(ctx, (int (*)(mu_Font, const char *, int))callback);
 }
 
 static void my_set_text_height_callback(mu_Context *ctx, intptr_t callback) {
-    ctx->text_height = (int (*)(mu_Font))callback;
+    set_text_height_callback(ctx, (int (*)(mu_Font))callback);
+}
+
+static void my_enable_text_width_cache(mu_Context *ctx) {
+    install_text_width_cache(ctx);
+}
+
+static void my_set_kerning(mu_Context *ctx, int a, int b, float adjust) {
+    if (ctx->text_width != cached_text_width) {
+        fputs("set_kerning needs enable_text_width_cache\n", stderr);
+        return;
+    }
+    ((CachedFont *)ctx->style->font)->set_kerning(a, b, adjust);
+    mu_text_metrics_changed(ctx);
 }
 
 static auto my_mu_checkbox(mu_Context *ctx, const std::string &label, intptr_t state) {
@@ -54,6 +169,11 @@ static auto my_mu_get_id(mu_Context *ctx, intptr_t data, int size) {
     return mu_get_id(ctx, (const void *)data, size);
 }
 
+// hash a static label once and pass the result to the `_hashed` id functions
+static mu_Id my_mu_hash_id(const std::string &label) {
+    return mu_hash_id(label.data(), label.size());
+}
+
 static auto my_mu_number_ex(mu_Context *ctx, intptr_t value, mu_Real step, const std::string &fmt, int opt) {
     return mu_number_ex(ctx, (mu_Real *)value, step, fmt.c_str(), opt);
 }
@@ -106,6 +226,154 @@ CONVERT_MY_FUNC_STR(mu_begin_treenode)
 CONVERT_MY_FUNC_STR(mu_begin_window, mu_Rect(rect))
 CONVERT_MY_FUNC_STR(mu_begin_panel)
 
+// labels registered with `intern`, shared by all contexts. a handle indexes
+// `interned`, whose labels point into the map's keys, which never move
+static std::unordered_map<std::string, int> interned_handles;
+static std::vector<mu_HashedLabel> interned;
+
+// the same string always gets the same handle
+static int my_mu_intern(mu_Context *, const std::string &str) {
+    auto it = interned_handles.emplace(str, (int)interned.size());
+    if (it.second) {
+        const std::string &key = it.first->first;
+        interned.push_back(mu_hashed_label(key.data(), key.size()));
+    }
+    return it.first->second;
+}
+
+static mu_HashedLabel *interned_label(int handle) {
+    assert(handle >= 0);
+    assert((size_t)handle < interned.size());
+    return &interned[handle];
+}
+
+#define CONVERT_MY_FUNC_HASHED(func, ...)                                \
+    static auto my_##func(mu_Context *ctx, int handle, ##__VA_ARGS__) { \
+        return func(ctx, interned_label(handle), ##__VA_ARGS__);        \
+    }
+
+CONVERT_MY_FUNC_HASHED(mu_label_hashed);
+CONVERT_MY_FUNC_HASHED(mu_open_popup_hashed);
+CONVERT_MY_FUNC_HASHED(mu_begin_popup_hashed);
+
+CONVERT_MY_FUNC_HASHED(mu_button_hashed, int(icon), int(opt));
+CONVERT_MY_FUNC_HASHED(mu_header_hashed, int(opt));
+CONVERT_MY_FUNC_HASHED(mu_begin_treenode_hashed, int(opt));
+CONVERT_MY_FUNC_HASHED(mu_begin_window_hashed, mu_Rect(rect), int(opt));
+CONVERT_MY_FUNC_HASHED(mu_begin_panel_hashed, int(opt));
+
+static auto my_mu_checkbox_hashed(mu_Context *ctx, int handle, intptr_t state) {
+    return mu_checkbox_hashed(ctx, interned_label(handle), (int *)state);
+}
+
+// struct arguments and results of the `_scratch` functions. JS writes and
+// reads them in place through `scratch_addr()` and the SCRATCH_* offsets,
+// where the embind functions above convert a fresh object on every call
+struct Scratch {
+    mu_Rect rect;
+    mu_Color color;
+};
+
+static Scratch scratch;
+
+static intptr_t my_mu_scratch_addr(const mu_Context &) {
+    return (intptr_t)&scratch;
+}
+
+static void my_mu_get_clip_rect_scratch(mu_Context *ctx) {
+    scratch.rect = mu_get_clip_rect(ctx);
+}
+
+static void my_mu_layout_next_scratch(mu_Context *ctx) {
+    scratch.rect = mu_layout_next(ctx);
+}
+
+static void my_mu_layout_set_next_scratch(mu_Context *ctx, int relative) {
+    mu_layout_set_next(ctx, scratch.rect, relative);
+}
+
+static void my_mu_push_clip_rect_scratch(mu_Context *ctx) {
+    mu_push_clip_rect(ctx, scratch.rect);
+}
+
+static int my_mu_check_clip_scratch(mu_Context *ctx) {
+    return mu_check_clip(ctx, scratch.rect);
+}
+
+static void my_mu_set_clip_scratch(mu_Context *ctx) {
+    mu_set_clip(ctx, scratch.rect);
+}
+
+static void my_mu_draw_rect_scratch(mu_Context *ctx) {
+    mu_draw_rect(ctx, scratch.rect, scratch.color);
+}
+
+static void my_mu_draw_box_scratch(mu_Context *ctx) {
+    mu_draw_box(ctx, scratch.rect, scratch.color);
+}
+
+static void my_mu_draw_icon_scratch(mu_Context *ctx, int id) {
+    mu_draw_icon(ctx, id, scratch.rect, scratch.color);
+}
+
+static void my_mu_draw_control_frame_scratch(mu_Context *ctx, mu_Id id, int colorid, int opt) {
+    mu_draw_control_frame(ctx, id, scratch.rect, colorid, opt);
+}
+
+static void my_mu_draw_control_text_scratch(mu_Context *ctx, const std::string &str, int colorid, int opt) {
+    mu_draw_control_text(ctx, str.c_str(), scratch.rect, colorid, opt);
+}
+
+static int my_mu_mouse_over_scratch(mu_Context *ctx) {
+    return mu_mouse_over(ctx, scratch.rect);
+}
+
+static void my_mu_update_control_scratch(mu_Context *ctx, mu_Id id, int opt) {
+    mu_update_control(ctx, id, scratch.rect, opt);
+}
+
+static int my_mu_begin_window_ex_scratch(mu_Context *ctx, const std::string &title, int opt) {
+    return mu_begin_window_ex(ctx, title.c_str(), scratch.rect, opt);
+}
+
+static int my_mu_begin_window_ex_hashed_scratch(mu_Context *ctx, int handle, int opt) {
+    return mu_begin_window_hashed(ctx, interned_label(handle), scratch.rect, opt);
+}
+
+// containers live in the context's pool, read them at the CONTAINER_* offsets
+static intptr_t my_mu_current_container_addr(mu_Context *ctx) {
+    return (intptr_t)mu_get_current_container(ctx);
+}
+
+static intptr_t my_mu_container_addr(mu_Context *ctx, const std::string &name) {
+    return (intptr_t)mu_get_container(ctx, name.c_str());
+}
+
+// buffers for `run_frame`, shared by all contexts. JS encodes a frame's ops
+// into the code buffer and reads the widget results back
+static std::vector<int32_t> frame_code;
+static std::vector<int32_t> frame_results;
+
+// grows the code buffer to at least `words`, keeping its contents; the
+// address may change
+static intptr_t my_mu_frame_code_reserve(mu_Context *, int words) {
+    if ((size_t)words > frame_code.size())
+        frame_code.resize(words);
+    return (intptr_t)frame_code.data();
+}
+
+static intptr_t my_mu_frame_results_reserve(mu_Context *, int count) {
+    if ((size_t)count > frame_results.size())
+        frame_results.resize(count);
+    return (intptr_t)frame_results.data();
+}
+
+// runs `len` words of ops at `code` as one frame, labels are `intern` handles
+static int my_mu_run_frame(mu_Context *ctx, intptr_t code, int len) {
+    FrameLabels labels = {interned.data(), (int)interned.size()};
+    return run_frame_program(ctx, (const int32_t *)code, len, labels, frame_results.data(), frame_results.size());
+}
+
 CONVERT_MY_FUNC_PTR(mu_slider, float, mu_Real(lo), mu_Real(hi));
 CONVERT_MY_FUNC_PTR(mu_textbox_ex, char, int(bufsz), int(opt));
 CONVERT_MY_FUNC_PTR(mu_textbox, char, int(bufsz));
@@ -125,6 +393,131 @@ static CommandList my_mu_commands(mu_Context *ctx) {
     return CommandList(val::array(vec));
 }
 
+// valid until the context's next `pack_commands` call
+static int my_mu_pack_commands(mu_Context *ctx) {
+    return packer_of(ctx).pack(ctx);
+}
+
+// must follow `pack_commands`, returns the number of records left
+static int my_mu_optimize_commands(mu_Context *ctx) {
+    return packer_of(ctx).optimize(ctx);
+}
+
+// what the last `optimize_commands` removed
+static val my_mu_optimize_stats(const mu_Context &ctx) {
+    const OptimizeStats &stats = packer_of(&ctx).optimize_stats();
+    val res = val::object();
+    res.set("records_before", stats.records_before);
+    res.set("records_after", stats.records_after);
+    res.set("clips_dropped", stats.clips_dropped);
+    res.set("culled", stats.culled);
+    res.set("merged", stats.merged);
+    return res;
+}
+
+// packs the frame built by the last `end()` and publishes a copy of it for a
+// consumer in another thread (see `FrameExchange`), returns its serial
+static int my_mu_publish_frame(mu_Context *ctx) {
+    CommandPacker &packer = packer_of(ctx);
+    packer.pack(ctx);
+    return exchange_of(ctx).publish(packer, ctx);
+}
+
+// the exchange state word, followed by the slot headers
+static intptr_t my_mu_frame_exchange_addr(const mu_Context &ctx) {
+    return exchange_of(&ctx).state_addr();
+}
+
+static intptr_t my_mu_packed_commands_addr(const mu_Context &ctx) {
+    return (intptr_t)packer_of(&ctx).data();
+}
+
+static intptr_t my_mu_packed_text_addr(const mu_Context &ctx) {
+    return (intptr_t)packer_of(&ctx).text();
+}
+
+static int my_mu_packed_text_generation(const mu_Context &ctx) {
+    return packer_of(&ctx).text_generation();
+}
+
+// the queue header is `head, tail, mask, dropped` as int32, followed by the
+// records pointer; JS writes records and `head` in place
+static intptr_t my_mu_input_queue_addr(const mu_Context &ctx) {
+    return (intptr_t)&ctx.input_queue;
+}
+
+static intptr_t my_mu_input_records_addr(const mu_Context &ctx) {
+    return (intptr_t)ctx.input_queue.records;
+}
+
+// returns 0 when the text would go past MU_INPUTTEXT_LIMIT
+static intptr_t my_mu_input_text_reserve(mu_Context *ctx, int n) {
+    return (intptr_t)mu_input_text_reserve(ctx, n);
+}
+
+static int my_mu_damage_count(const mu_Context &ctx) {
+    return ctx.damage.count;
+}
+
+// `damage_count()` rects of 4 int32 (x, y, w, h)
+static intptr_t my_mu_damage_rects_addr(const mu_Context &ctx) {
+    return (intptr_t)ctx.damage.rects;
+}
+
+static mu_Id my_mu_damage_base(const mu_Context &ctx) {
+    return ctx.damage.base;
+}
+
+static mu_Pool *my_mu_container_pool(mu_Context *ctx) {
+    return &ctx->container_pool;
+}
+
+static mu_Pool *my_mu_treenode_pool(mu_Context *ctx) {
+    return &ctx->treenode_pool;
+}
+
+static mu_Id my_mu_pool_item_id(const mu_Pool &pool, int idx) {
+    return idx >= 0 && idx < pool.len ? pool.items[idx].id : 0;
+}
+
+static int my_mu_pool_item_last_update(const mu_Pool &pool, int idx) {
+    return idx >= 0 && idx < pool.len ? pool.items[idx].last_update : 0;
+}
+
+// lays out `count` rows but only calls `fn(i)` for the visible ones
+static void my_mu_virtual_list(mu_Context *ctx, int count, int row_height, emscripten::val fn) {
+    mu_VirtualList list;
+    mu_begin_virtual_list(ctx, &list, count, row_height);
+    for (int i = list.first; i < list.last; ++i) {
+        fn(i);
+    }
+    mu_end_virtual_list(ctx, &list);
+}
+
+// `alpha` is a Uint8Array (or array) of `w * h` coverage bytes
+static void my_raster_set_glyph(Rasterizer &raster, unsigned codepoint, int w, int h, int x, int y, int advance,
+                                emscripten::val alpha) {
+    std::vector<uint8_t> bytes = convertJSArrayToNumberVector<uint8_t>(alpha);
+    if (w < 0 || h < 0 || bytes.size() < (size_t)w * h) {
+        fputs("set_glyph get fewer than w * h alpha bytes\n", stderr);
+        return;
+    }
+    raster.set_glyph(codepoint, w, h, x, y, advance, bytes.data());
+}
+
+static void my_raster_draw(Rasterizer &raster, mu_Context *ctx) {
+    raster.draw(ctx);
+}
+
+static void my_raster_draw_area(Rasterizer &raster, mu_Context *ctx, mu_Rect area) {
+    raster.draw(ctx, area);
+}
+
+// `width() * height()` RGBA pixels, valid until the next `resize`
+static intptr_t my_raster_pixels_addr(const Rasterizer &raster) {
+    return (intptr_t)raster.pixels();
+}
+
 static void my_mu_layout_row(mu_Context *ctx, NumberList widths, int height) {
     if (!widths.isArray()) {
         fputs("layout_row get a non-array argument\n", stderr);
@@ -140,13 +533,18 @@ static void my_mu_layout_row(mu_Context *ctx, NumberList widths, int height) {
 
 EMSCRIPTEN_BINDINGS(microui) {
     class_<mu_Context>("Context")
-        .constructor(my_new_mu_Context, allow_raw_pointers())
+        .smart_ptr<std::shared_ptr<mu_Context>>("ContextPtr")
+        .constructor(&my_new_mu_Context)
+        .constructor(&my_new_mu_Context_ex)
         .function("begin", mu_begin, allow_raw_pointers())
         .function("end", mu_end, allow_raw_pointers())
+        .function("needs_frame", mu_needs_frame, allow_raw_pointers())
         .function("set_focus", mu_set_focus, allow_raw_pointers())
         .function("get_id", my_mu_get_id, allow_raw_pointers())
         .function("push_id", my_mu_push_id, allow_raw_pointers())
         .function("push_id_ptr", my_mu_push_id_ptr, allow_raw_pointers())
+        .function("get_id_hashed", mu_get_id_hashed, allow_raw_pointers())
+        .function("push_id_hashed", mu_push_id_hashed, allow_raw_pointers())
         .function("pop_id", mu_pop_id, allow_raw_pointers())
         .function("push_clip_rect", mu_push_clip_rect, allow_raw_pointers())
         .function("pop_clip_rect", mu_pop_clip_rect, allow_raw_pointers())
@@ -155,10 +553,15 @@ EMSCRIPTEN_BINDINGS(microui) {
         .function("get_current_container", mu_get_current_container, allow_raw_pointers())
         .function("get_container", my_mu_get_container, allow_raw_pointers())
         .function("bring_to_front", mu_bring_to_front, allow_raw_pointers())
-        // need bind `mu_PoolItem`
-        // .function("pool_init", mu_pool_init, allow_raw_pointers())
-        // .function("pool_get", mu_pool_get, allow_raw_pointers())
-        // .function("pool_update", mu_pool_update, allow_raw_pointers())
+        .function("damage_count", my_mu_damage_count)
+        .function("damage_rects_addr", my_mu_damage_rects_addr)
+        .function("damage_base", my_mu_damage_base)
+        .function("container_pool", my_mu_container_pool, allow_raw_pointers())
+        .function("treenode_pool", my_mu_treenode_pool, allow_raw_pointers())
+        .function("pool_init", mu_pool_init, allow_raw_pointers())
+        .function("pool_get", mu_pool_get, allow_raw_pointers())
+        .function("pool_update", mu_pool_update, allow_raw_pointers())
+        .function("pool_remove", mu_pool_remove, allow_raw_pointers())
         .function("input_mousemove", mu_input_mousemove, allow_raw_pointers())
         .function("input_mousedown", mu_input_mousedown, allow_raw_pointers())
         .function("input_mouseup", mu_input_mouseup, allow_raw_pointers())
@@ -166,10 +569,27 @@ EMSCRIPTEN_BINDINGS(microui) {
         .function("input_keydown", mu_input_keydown, allow_raw_pointers())
         .function("input_keyup", mu_input_keyup, allow_raw_pointers())
         .function("input_text", my_mu_input_text, allow_raw_pointers())
+        .function("input_text_reserve", my_mu_input_text_reserve, allow_raw_pointers())
+        .function("input_text_commit", mu_input_text_commit, allow_raw_pointers())
+        .function("drain_input", mu_drain_input, allow_raw_pointers())
+        .function("input_queue_addr", my_mu_input_queue_addr)
+        .function("input_records_addr", my_mu_input_records_addr)
         .function("push_command", mu_push_command, allow_raw_pointers())
         // use `commands` instead
         // .function("next_command", mu_next_command, allow_raw_pointers())
         .function("commands", my_mu_commands, allow_raw_pointers())
+        .function("set_command_list_limit", my_mu_set_command_list_limit)
+        .function("command_list_overflow", my_mu_command_list_overflow)
+        .function("command_list_capacity", my_mu_command_list_capacity)
+        .function("memory_footprint", my_mu_memory_footprint)
+        .function("pack_commands", my_mu_pack_commands, allow_raw_pointers())
+        .function("optimize_commands", my_mu_optimize_commands, allow_raw_pointers())
+        .function("optimize_stats", my_mu_optimize_stats)
+        .function("packed_commands_addr", my_mu_packed_commands_addr)
+        .function("packed_text_addr", my_mu_packed_text_addr)
+        .function("packed_text_generation", my_mu_packed_text_generation)
+        .function("publish_frame", my_mu_publish_frame, allow_raw_pointers())
+        .function("frame_exchange_addr", my_mu_frame_exchange_addr)
         .function("set_clip", mu_set_clip, allow_raw_pointers())
         .function("draw_rect", mu_draw_rect, allow_raw_pointers())
         .function("draw_box", mu_draw_box, allow_raw_pointers())
@@ -212,13 +632,53 @@ EMSCRIPTEN_BINDINGS(microui) {
         .function("begin_popup", my_mu_begin_popup, allow_raw_pointers())
         .function("end_popup", mu_end_popup, allow_raw_pointers())
         .function("begin_panel_ex", my_mu_begin_panel_ex, allow_raw_pointers())
+        .function("virtual_list", my_mu_virtual_list, allow_raw_pointers())
         .function("end_panel", mu_end_panel, allow_raw_pointers())
+        // the label functions above, taking a handle from `intern` instead of
+        // a string; `index.mjs` dispatches to these when given a number
+        .function("intern", my_mu_intern, allow_raw_pointers())
+        .function("label_hashed", my_mu_label_hashed, allow_raw_pointers())
+        .function("button_ex_hashed", my_mu_button_hashed, allow_raw_pointers())
+        .function("checkbox_hashed", my_mu_checkbox_hashed, allow_raw_pointers())
+        .function("header_ex_hashed", my_mu_header_hashed, allow_raw_pointers())
+        .function("begin_treenode_ex_hashed", my_mu_begin_treenode_hashed, allow_raw_pointers())
+        .function("begin_window_ex_hashed", my_mu_begin_window_hashed, allow_raw_pointers())
+        .function("open_popup_hashed", my_mu_open_popup_hashed, allow_raw_pointers())
+        .function("begin_popup_hashed", my_mu_begin_popup_hashed, allow_raw_pointers())
+        .function("begin_panel_ex_hashed", my_mu_begin_panel_hashed, allow_raw_pointers())
         // workaround
         .function("set_text_width_callback", my_set_text_width_callback, allow_raw_pointers())
         .function("set_text_height_callback", my_set_text_height_callback, allow_raw_pointers())
+        .function("enable_text_width_cache", my_enable_text_width_cache, allow_raw_pointers())
+        .function("set_kerning", my_set_kerning, allow_raw_pointers())
         .function("style_colors_addr", my_mu_style_colors_addr)
+        // the struct view layer, see `Scratch`
+        .function("scratch_addr", my_mu_scratch_addr)
+        .function("get_clip_rect_scratch", my_mu_get_clip_rect_scratch, allow_raw_pointers())
+        .function("layout_next_scratch", my_mu_layout_next_scratch, allow_raw_pointers())
+        .function("layout_set_next_scratch", my_mu_layout_set_next_scratch, allow_raw_pointers())
+        .function("push_clip_rect_scratch", my_mu_push_clip_rect_scratch, allow_raw_pointers())
+        .function("check_clip_scratch", my_mu_check_clip_scratch, allow_raw_pointers())
+        .function("set_clip_scratch", my_mu_set_clip_scratch, allow_raw_pointers())
+        .function("draw_rect_scratch", my_mu_draw_rect_scratch, allow_raw_pointers())
+        .function("draw_box_scratch", my_mu_draw_box_scratch, allow_raw_pointers())
+        .function("draw_icon_scratch", my_mu_draw_icon_scratch, allow_raw_pointers())
+        .function("draw_control_frame_scratch", my_mu_draw_control_frame_scratch, allow_raw_pointers())
+        .function("draw_control_text_scratch", my_mu_draw_control_text_scratch, allow_raw_pointers())
+        .function("mouse_over_scratch", my_mu_mouse_over_scratch, allow_raw_pointers())
+        .function("update_control_scratch", my_mu_update_control_scratch, allow_raw_pointers())
+        .function("begin_window_ex_scratch", my_mu_begin_window_ex_scratch, allow_raw_pointers())
+        .function("begin_window_ex_hashed_scratch", my_mu_begin_window_ex_hashed_scratch, allow_raw_pointers())
+        .function("current_container_addr", my_mu_current_container_addr, allow_raw_pointers())
+        .function("container_addr", my_mu_container_addr, allow_raw_pointers())
+        // frames encoded by `FrameBuilder`, see `frame_program.h`
+        .function("frame_code_reserve", my_mu_frame_code_reserve, allow_raw_pointers())
+        .function("frame_results_reserve", my_mu_frame_results_reserve, allow_raw_pointers())
+        .function("run_frame", my_mu_run_frame, allow_raw_pointers())
         .function("set_style_color", my_mu_set_style_color)
-        .property("last_id", &mu_Context::last_id);
+        .property("last_id", &mu_Context::last_id)
+        .property("frame_hash", &mu_Context::frame_hash)
+        .property("frame_changed", &mu_Context::frame_changed);
 
     value_object<mu_Vec2>("Vec2").field("x", &mu_Vec2::x).field("y", &mu_Vec2::y);
 
@@ -234,6 +694,17 @@ EMSCRIPTEN_BINDINGS(microui) {
         .field("b", &mu_Color::b)
         .field("a", &mu_Color::a);
 
+    class_<Rasterizer>("Rasterizer")
+        .constructor()
+        .function("resize", &Rasterizer::resize)
+        .function("clear", &Rasterizer::clear)
+        .function("draw", my_raster_draw, allow_raw_pointers())
+        .function("draw_area", my_raster_draw_area, allow_raw_pointers())
+        .function("set_glyph", my_raster_set_glyph)
+        .function("pixels_addr", my_raster_pixels_addr)
+        .property("width", &Rasterizer::width)
+        .property("height", &Rasterizer::height);
+
     class_<mu_Command>("Command")
         .property("type", &mu_Command::type)
         .property("text", &mu_Command::text)
@@ -267,6 +738,12 @@ EMSCRIPTEN_BINDINGS(microui) {
         .property("scroll", &mu_Container::scroll)
         .property("content_size", &mu_Container::content_size);
 
+    // views of the context's pools, owned by the context
+    class_<mu_Pool>("Pool")
+        .property("len", &mu_Pool::len)
+        .function("item_id", my_mu_pool_item_id)
+        .function("item_last_update", my_mu_pool_item_last_update);
+
     class_<mu_Style>("Style")
         // .property("font", &mu_Style::font)
         .property("size", &mu_Style::size)
@@ -279,6 +756,8 @@ EMSCRIPTEN_BINDINGS(microui) {
         .function("set_color", my_mu_style_set_color)
         .function("get_color", my_mu_style_get_color);
 
+    function("hash_id", &my_mu_hash_id);
+
     constant<std::string>("VERSION", MU_VERSION);
 
     constant<int>("MAX_WIDTHS", MU_MAX_WIDTHS);
@@ -291,6 +770,75 @@ EMSCRIPTEN_BINDINGS(microui) {
     constant<int>("COMMAND_TEXT", MU_COMMAND_TEXT);
     constant<int>("COMMAND_ICON", MU_COMMAND_ICON);
 
+    constant<int>("INPUT_MOUSEMOVE", MU_INPUT_MOUSEMOVE);
+    constant<int>("INPUT_MOUSEDOWN", MU_INPUT_MOUSEDOWN);
+    constant<int>("INPUT_MOUSEUP", MU_INPUT_MOUSEUP);
+    constant<int>("INPUT_SCROLL", MU_INPUT_SCROLL);
+    constant<int>("INPUT_KEYDOWN", MU_INPUT_KEYDOWN);
+    constant<int>("INPUT_KEYUP", MU_INPUT_KEYUP);
+    constant<int>("INPUT_TEXT", MU_INPUT_TEXT);
+    constant<int>("INPUT_WORDS", MU_INPUT_WORDS);
+
+    constant<int>("PACKED_TYPE", PACKED_TYPE);
+    constant<int>("PACKED_X", PACKED_X);
+    constant<int>("PACKED_Y", PACKED_Y);
+    constant<int>("PACKED_W", PACKED_W);
+    constant<int>("PACKED_H", PACKED_H);
+    constant<int>("PACKED_COLOR", PACKED_COLOR);
+    constant<int>("PACKED_ARG0", PACKED_ARG0);
+    constant<int>("PACKED_ARG1", PACKED_ARG1);
+    constant<int>("PACKED_WORDS", PACKED_WORDS);
+    constant<int>("PACKED_TEXT_OFFSET", PACKED_TEXT_OFFSET);
+    constant<int>("PACKED_TEXT_LEN", PACKED_TEXT_LEN);
+    constant<int>("PACKED_TEXT_ID", PACKED_TEXT_ID);
+    constant<int>("PACKED_TEXT_WIDTH", PACKED_TEXT_WIDTH);
+
+    constant<int>("FRAME_SERIAL", FRAME_SERIAL);
+    constant<int>("FRAME_COUNT", FRAME_COUNT);
+    constant<int>("FRAME_RECORDS", FRAME_RECORDS);
+    constant<int>("FRAME_TEXT", FRAME_TEXT);
+    constant<int>("FRAME_TEXT_GENERATION", FRAME_TEXT_GENERATION);
+    constant<int>("FRAME_HASH", FRAME_HASH);
+    constant<int>("FRAME_DAMAGE_BASE", FRAME_DAMAGE_BASE);
+    constant<int>("FRAME_DAMAGE_COUNT", FRAME_DAMAGE_COUNT);
+    constant<int>("FRAME_DAMAGE", FRAME_DAMAGE);
+    constant<int>("FRAME_WORDS", FRAME_WORDS);
+    constant<int>("FRAME_FRESH", FrameExchange::FRESH);
+
+    constant<int>("RASTER_ICON_SIZE", Rasterizer::ICON_SIZE);
+
+    constant<int>("FRAME_OP_LAYOUT_ROW", FRAME_OP_LAYOUT_ROW);
+    constant<int>("FRAME_OP_BEGIN_COLUMN", FRAME_OP_BEGIN_COLUMN);
+    constant<int>("FRAME_OP_END_COLUMN", FRAME_OP_END_COLUMN);
+    constant<int>("FRAME_OP_PUSH_ID", FRAME_OP_PUSH_ID);
+    constant<int>("FRAME_OP_PUSH_ID_HASHED", FRAME_OP_PUSH_ID_HASHED);
+    constant<int>("FRAME_OP_POP_ID", FRAME_OP_POP_ID);
+    constant<int>("FRAME_OP_TEXT", FRAME_OP_TEXT);
+    constant<int>("FRAME_OP_LABEL", FRAME_OP_LABEL);
+    constant<int>("FRAME_OP_BUTTON", FRAME_OP_BUTTON);
+    constant<int>("FRAME_OP_CHECKBOX", FRAME_OP_CHECKBOX);
+    constant<int>("FRAME_OP_TEXTBOX", FRAME_OP_TEXTBOX);
+    constant<int>("FRAME_OP_SLIDER", FRAME_OP_SLIDER);
+    constant<int>("FRAME_OP_NUMBER", FRAME_OP_NUMBER);
+    constant<int>("FRAME_OP_HEADER", FRAME_OP_HEADER);
+    constant<int>("FRAME_OP_BEGIN_TREENODE", FRAME_OP_BEGIN_TREENODE);
+    constant<int>("FRAME_OP_END_TREENODE", FRAME_OP_END_TREENODE);
+    constant<int>("FRAME_OP_BEGIN_WINDOW", FRAME_OP_BEGIN_WINDOW);
+    constant<int>("FRAME_OP_END_WINDOW", FRAME_OP_END_WINDOW);
+    constant<int>("FRAME_OP_OPEN_POPUP", FRAME_OP_OPEN_POPUP);
+    constant<int>("FRAME_OP_BEGIN_POPUP", FRAME_OP_BEGIN_POPUP);
+    constant<int>("FRAME_OP_END_POPUP", FRAME_OP_END_POPUP);
+    constant<int>("FRAME_OP_BEGIN_PANEL", FRAME_OP_BEGIN_PANEL);
+    constant<int>("FRAME_OP_END_PANEL", FRAME_OP_END_PANEL);
+
+    // byte offsets for the struct views
+    constant<int>("SCRATCH_RECT", offsetof(Scratch, rect));
+    constant<int>("SCRATCH_COLOR", offsetof(Scratch, color));
+    constant<int>("CONTAINER_RECT", offsetof(mu_Container, rect));
+    constant<int>("CONTAINER_BODY", offsetof(mu_Container, body));
+    constant<int>("CONTAINER_CONTENT_SIZE", offsetof(mu_Container, content_size));
+    constant<int>("CONTAINER_SCROLL", offsetof(mu_Container, scroll));
+
     constant<int>("COLOR_TEXT", MU_COLOR_TEXT);
     constant<int>("COLOR_BORDER", MU_COLOR_BORDER);
     constant<int>("COLOR_WINDOWBG", MU_COLOR_WINDOWBG);
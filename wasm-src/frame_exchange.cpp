@@ -0,0 +1,58 @@
+#include "frame_exchange.h"
+
+FrameExchange::FrameExchange() {
+    shared.state.store(2, std::memory_order_relaxed);
+    for (auto &h : shared.headers)
+        for (int32_t &w : h)
+            w = 0;
+}
+
+int FrameExchange::publish(const CommandPacker &packer, const mu_Context *ctx) {
+    Slot &slot = slots[back];
+    int count = packer.count();
+    slot.words.assign(packer.data(), packer.data() + count * PACKED_WORDS);
+
+    // copy the strings that are drawn, the text table may be compacted while
+    // this frame is still on screen
+    slot.text.clear();
+    for (int i = 0; i < count; ++i) {
+        int32_t *rec = &slot.words[i * PACKED_WORDS];
+        if (rec[PACKED_TYPE] != MU_COMMAND_TEXT)
+            continue;
+        const char *str = packer.text() + rec[PACKED_TEXT_OFFSET];
+        rec[PACKED_TEXT_OFFSET] = slot.text.size();
+        slot.text.insert(slot.text.end(), str, str + rec[PACKED_TEXT_LEN]);
+    }
+
+    int32_t *h = shared.headers[back];
+    h[FRAME_SERIAL] = ++serial;
+    h[FRAME_COUNT] = count;
+    h[FRAME_RECORDS] = (int32_t)(intptr_t)slot.words.data();
+    h[FRAME_TEXT] = (int32_t)(intptr_t)slot.text.data();
+    h[FRAME_TEXT_GENERATION] = packer.text_generation();
+    h[FRAME_HASH] = (int32_t)ctx->frame_hash;
+    h[FRAME_DAMAGE_BASE] = (int32_t)ctx->damage.base;
+    h[FRAME_DAMAGE_COUNT] = ctx->damage.count;
+    for (int i = 0; i < ctx->damage.count; ++i) {
+        const mu_Rect &r = ctx->damage.rects[i];
+        int32_t *d = &h[FRAME_DAMAGE + i * 4];
+        d[0] = r.x;
+        d[1] = r.y;
+        d[2] = r.w;
+        d[3] = r.h;
+    }
+
+    // release the slot's contents together with its index
+    int32_t prev = shared.state.exchange(back | FRESH, std::memory_order_acq_rel);
+    back = prev & ~FRESH;
+    return serial;
+}
+
+const int32_t *FrameExchange::acquire() {
+    // only the consumer clears `FRESH`, so it can't go away before the exchange
+    if (!(shared.state.load(std::memory_order_acquire) & FRESH))
+        return NULL;
+    int32_t prev = shared.state.exchange(front, std::memory_order_acq_rel);
+    front = prev & ~FRESH;
+    return shared.headers[front];
+}
@@ -0,0 +1,90 @@
+#ifndef FRAME_EXCHANGE_H
+#define FRAME_EXCHANGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "microui.h"
+}
+
+#include "packed_commands.h"
+
+// A published frame is described by a header of `FRAME_WORDS` int32 words,
+// so the thread painting it can read it through an `Int32Array` over the
+// (shared) WASM memory:
+//
+//   SERIAL          | frames published before this one, plus one
+//   COUNT           | packed records, see `CommandPacker`
+//   RECORDS         | address of the records
+//   TEXT            | address of the strings, TEXT offsets are relative to it
+//   TEXT_GENERATION | see `TextTable::generation`
+//   HASH            | `mu_Context::frame_hash`
+//   DAMAGE_BASE     | `mu_Context::damage.base`
+//   DAMAGE_COUNT    | damaged rects
+//   DAMAGE          | `MU_DAMAGE_MAX` rects of x, y, w, h
+enum {
+    FRAME_SERIAL,
+    FRAME_COUNT,
+    FRAME_RECORDS,
+    FRAME_TEXT,
+    FRAME_TEXT_GENERATION,
+    FRAME_HASH,
+    FRAME_DAMAGE_BASE,
+    FRAME_DAMAGE_COUNT,
+    FRAME_DAMAGE,
+    FRAME_WORDS = FRAME_DAMAGE + MU_DAMAGE_MAX * 4
+};
+
+// Hands packed frames from the thread running the UI to the thread painting
+// them without locks. There are three slots: the producer fills its back slot
+// and swaps it with the middle one, the consumer swaps its front slot with
+// the middle one whenever a newer frame was published. Neither side ever
+// waits for the other, and a slow painter only skips frames.
+//
+// The swaps are single atomic exchanges of `state` (the middle slot, plus
+// `FRESH` once a frame was published into it), so the consumer can be plain
+// JS using `Atomics.exchange` on the word at `state_addr()`; the three
+// headers follow it.
+class FrameExchange {
+  public:
+    enum { SLOTS = 3, FRESH = 4 };
+
+    FrameExchange();
+
+    // producer: copies the records packed by `packer` for `ctx`, returns the
+    // serial of the published frame
+    int publish(const CommandPacker &packer, const mu_Context *ctx);
+
+    // consumer: the newest published frame, or NULL when nothing was
+    // published since the last call. the header (and the records and strings
+    // it points to) stays valid until the next call
+    const int32_t *acquire();
+    // records and strings of the last acquired frame, for native consumers
+    // (the addresses in the header only fit in WASM)
+    const int32_t *front_records() const { return slots[front].words.data(); }
+    const char *front_text() const { return slots[front].text.data(); }
+
+    intptr_t state_addr() { return (intptr_t)&shared; }
+
+  private:
+    struct Slot {
+        std::vector<int32_t> words;
+        std::vector<char> text;
+    };
+
+    struct Shared {
+        std::atomic<int32_t> state;
+        int32_t headers[SLOTS][FRAME_WORDS];
+    };
+
+    Shared shared;
+    Slot slots[SLOTS];
+    int back = 0;
+    int front = 1;
+    int serial = 0;
+};
+
+#endif
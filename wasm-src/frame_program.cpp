@@ -0,0 +1,198 @@
+#include "frame_program.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static_assert(sizeof(int) == sizeof(int32_t), "LAYOUT_ROW widths are read in place as int");
+
+// where an op's operands are, as indices into its words (0 for none)
+struct OpInfo {
+    // words including the op; LAYOUT_ROW has its widths on top
+    int size;
+    int slot;
+    int skip;
+    int label;
+    // a label that may also be -1
+    int optional_label;
+};
+
+static const OpInfo op_info[FRAME_OP_COUNT] = {
+    /* LAYOUT_ROW     */ {3, 0, 0, 0, 0},
+    /* BEGIN_COLUMN   */ {1, 0, 0, 0, 0},
+    /* END_COLUMN     */ {1, 0, 0, 0, 0},
+    /* PUSH_ID        */ {2, 0, 0, 0, 0},
+    /* PUSH_ID_HASHED */ {2, 0, 0, 1, 0},
+    /* POP_ID         */ {1, 0, 0, 0, 0},
+    /* TEXT           */ {2, 0, 0, 1, 0},
+    /* LABEL          */ {2, 0, 0, 1, 0},
+    /* BUTTON         */ {5, 1, 0, 0, 2},
+    /* CHECKBOX       */ {4, 1, 0, 2, 0},
+    /* TEXTBOX        */ {5, 1, 0, 0, 0},
+    /* SLIDER         */ {8, 1, 0, 0, 6},
+    /* NUMBER         */ {6, 1, 0, 0, 4},
+    /* HEADER         */ {5, 1, 4, 2, 0},
+    /* BEGIN_TREENODE */ {5, 1, 4, 2, 0},
+    /* END_TREENODE   */ {1, 0, 0, 0, 0},
+    /* BEGIN_WINDOW   */ {9, 1, 8, 2, 0},
+    /* END_WINDOW     */ {1, 0, 0, 0, 0},
+    /* OPEN_POPUP     */ {2, 0, 0, 1, 0},
+    /* BEGIN_POPUP    */ {4, 1, 3, 2, 0},
+    /* END_POPUP      */ {1, 0, 0, 0, 0},
+    /* BEGIN_PANEL    */ {3, 0, 0, 1, 0},
+    /* END_PANEL      */ {1, 0, 0, 0, 0},
+};
+
+static bool fail(const char *what, int pc) {
+    fprintf(stderr, "run_frame: %s at word %d\n", what, pc);
+    return false;
+}
+
+static bool check(const int32_t *code, int len, FrameLabels labels, int result_count) {
+    // skips must land on an op, or the loop would decode an operand as one
+    std::vector<bool> op_start(len + 1, false);
+    std::vector<int> skips;
+    for (int pc = 0; pc < len;) {
+        const int32_t *a = code + pc;
+        if (a[0] < 0 || a[0] >= FRAME_OP_COUNT)
+            return fail("unknown op", pc);
+        const OpInfo &info = op_info[a[0]];
+        int size = info.size;
+        if (a[0] == FRAME_OP_LAYOUT_ROW) {
+            if (pc + 1 >= len || a[1] < 0 || a[1] > MU_MAX_WIDTHS)
+                return fail("bad LAYOUT_ROW width count", pc);
+            size += a[1];
+        }
+        if (size > len - pc)
+            return fail("op cut short", pc);
+        if (info.slot && a[info.slot] >= result_count)
+            return fail("result slot out of range", pc);
+        if (info.label && (a[info.label] < 0 || a[info.label] >= labels.count))
+            return fail("unknown label", pc);
+        if (info.optional_label && (a[info.optional_label] < -1 || a[info.optional_label] >= labels.count))
+            return fail("unknown label", pc);
+        if (info.skip) {
+            if (a[info.skip] < 0 || a[info.skip] > len - pc - size)
+                return fail("skip out of range", pc);
+            skips.push_back(pc);
+        }
+        op_start[pc] = true;
+        pc += size;
+    }
+    op_start[len] = true;
+    for (int pc : skips) {
+        const int32_t *a = code + pc;
+        const OpInfo &info = op_info[a[0]];
+        if (!op_start[pc + info.size + a[info.skip]])
+            return fail("skip not to an op", pc);
+    }
+    return true;
+}
+
+static mu_Real real(int32_t bits) {
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// addresses are wasm32 pointers
+template <class T>
+static T *ptr(int32_t addr) {
+    return (T *)(intptr_t)addr;
+}
+
+int run_frame_program(mu_Context *ctx, const int32_t *code, int len, FrameLabels labels, int32_t *results,
+                      int result_count) {
+    if (!check(code, len, labels, result_count))
+        return -1;
+    memset(results, 0, result_count * sizeof(*results));
+    auto label = [&](int32_t i) { return i < 0 ? NULL : &labels.items[i]; };
+    auto fmt = [&](int32_t i) { return i < 0 ? MU_SLIDER_FMT : labels.items[i].str; };
+
+    mu_begin(ctx);
+    for (int pc = 0; pc < len;) {
+        const int32_t *a = code + pc;
+        const OpInfo &info = op_info[a[0]];
+        int size = info.size;
+        int res = 0;
+        switch (a[0]) {
+        case FRAME_OP_LAYOUT_ROW:
+            size += a[1];
+            mu_layout_row(ctx, a[1], (const int *)(a + 3), a[2]);
+            break;
+        case FRAME_OP_BEGIN_COLUMN:
+            mu_layout_begin_column(ctx);
+            break;
+        case FRAME_OP_END_COLUMN:
+            mu_layout_end_column(ctx);
+            break;
+        case FRAME_OP_PUSH_ID:
+            mu_push_id(ctx, &a[1], sizeof(a[1]));
+            break;
+        case FRAME_OP_PUSH_ID_HASHED:
+            mu_push_id_hashed(ctx, label(a[1])->hash);
+            break;
+        case FRAME_OP_POP_ID:
+            mu_pop_id(ctx);
+            break;
+        case FRAME_OP_TEXT:
+            mu_text(ctx, label(a[1])->str);
+            break;
+        case FRAME_OP_LABEL:
+            mu_label_hashed(ctx, label(a[1]));
+            break;
+        case FRAME_OP_BUTTON:
+            res = mu_button_hashed(ctx, label(a[2]), a[3], a[4]);
+            break;
+        case FRAME_OP_CHECKBOX:
+            res = mu_checkbox_hashed(ctx, label(a[2]), ptr<int>(a[3]));
+            break;
+        case FRAME_OP_TEXTBOX:
+            res = mu_textbox_ex(ctx, ptr<char>(a[2]), a[3], a[4]);
+            break;
+        case FRAME_OP_SLIDER:
+            res = mu_slider_ex(ctx, ptr<mu_Real>(a[2]), real(a[3]), real(a[4]), real(a[5]), fmt(a[6]), a[7]);
+            break;
+        case FRAME_OP_NUMBER:
+            res = mu_number_ex(ctx, ptr<mu_Real>(a[2]), real(a[3]), fmt(a[4]), a[5]);
+            break;
+        case FRAME_OP_HEADER:
+            res = mu_header_hashed(ctx, label(a[2]), a[3]);
+            break;
+        case FRAME_OP_BEGIN_TREENODE:
+            res = mu_begin_treenode_hashed(ctx, label(a[2]), a[3]);
+            break;
+        case FRAME_OP_END_TREENODE:
+            mu_end_treenode(ctx);
+            break;
+        case FRAME_OP_BEGIN_WINDOW:
+            res = mu_begin_window_hashed(ctx, label(a[2]), mu_rect(a[3], a[4], a[5], a[6]), a[7]);
+            break;
+        case FRAME_OP_END_WINDOW:
+            mu_end_window(ctx);
+            break;
+        case FRAME_OP_OPEN_POPUP:
+            mu_open_popup_hashed(ctx, label(a[1]));
+            break;
+        case FRAME_OP_BEGIN_POPUP:
+            res = mu_begin_popup_hashed(ctx, label(a[2]));
+            break;
+        case FRAME_OP_END_POPUP:
+            mu_end_popup(ctx);
+            break;
+        case FRAME_OP_BEGIN_PANEL:
+            mu_begin_panel_hashed(ctx, label(a[1]), a[2]);
+            break;
+        case FRAME_OP_END_PANEL:
+            mu_end_panel(ctx);
+            break;
+        }
+        if (info.slot && a[info.slot] >= 0)
+            results[a[info.slot]] = res;
+        pc += size;
+        if (info.skip && !(res & MU_RES_ACTIVE))
+            pc += a[info.skip];
+    }
+    mu_end(ctx);
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef FRAME_PROGRAM_H
+#define FRAME_PROGRAM_H
+
+#include <cstdint>
+
+extern "C" {
+#include "microui.h"
+}
+
+// A frame's widget calls encoded as int32 words, so JS can build a whole
+// frame in a buffer and run it with one call instead of one call per widget.
+// Each op is its opcode followed by its operands:
+//
+//   op             | operands
+//   ---------------+--------------------------------------------------
+//   LAYOUT_ROW     | n, height, n widths
+//   BEGIN_COLUMN   |
+//   END_COLUMN     |
+//   PUSH_ID        | value (hashed as an int32, like `push_id_ptr`)
+//   PUSH_ID_HASHED | label
+//   POP_ID         |
+//   TEXT           | label
+//   LABEL          | label
+//   BUTTON         | slot, label (-1 for icon only), icon, opt
+//   CHECKBOX       | slot, label, state (int*)
+//   TEXTBOX        | slot, buf (char*), bufsz, opt
+//   SLIDER         | slot, value (mu_Real*), low, high, step, fmt, opt
+//   NUMBER         | slot, value (mu_Real*), step, fmt, opt
+//   HEADER         | slot, label, opt, skip
+//   BEGIN_TREENODE | slot, label, opt, skip
+//   END_TREENODE   |
+//   BEGIN_WINDOW   | slot, label, x, y, w, h, opt, skip
+//   END_WINDOW     |
+//   OPEN_POPUP     | label
+//   BEGIN_POPUP    | slot, label, skip
+//   END_POPUP      |
+//   BEGIN_PANEL    | label, opt
+//   END_PANEL      |
+//
+// `label` indexes the label table, `fmt` too, or is -1 for `MU_SLIDER_FMT`;
+// labels used as TEXT or fmt must be NUL terminated. `low`, `high` and `step`
+// are float32 bits. A widget's result is stored at `results[slot]` unless
+// `slot` is negative. When HEADER, BEGIN_TREENODE, BEGIN_WINDOW or
+// BEGIN_POPUP aren't active, the next `skip` words are skipped; they must
+// cover the body and its END op.
+enum {
+    FRAME_OP_LAYOUT_ROW,
+    FRAME_OP_BEGIN_COLUMN,
+    FRAME_OP_END_COLUMN,
+    FRAME_OP_PUSH_ID,
+    FRAME_OP_PUSH_ID_HASHED,
+    FRAME_OP_POP_ID,
+    FRAME_OP_TEXT,
+    FRAME_OP_LABEL,
+    FRAME_OP_BUTTON,
+    FRAME_OP_CHECKBOX,
+    FRAME_OP_TEXTBOX,
+    FRAME_OP_SLIDER,
+    FRAME_OP_NUMBER,
+    FRAME_OP_HEADER,
+    FRAME_OP_BEGIN_TREENODE,
+    FRAME_OP_END_TREENODE,
+    FRAME_OP_BEGIN_WINDOW,
+    FRAME_OP_END_WINDOW,
+    FRAME_OP_OPEN_POPUP,
+    FRAME_OP_BEGIN_POPUP,
+    FRAME_OP_END_POPUP,
+    FRAME_OP_BEGIN_PANEL,
+    FRAME_OP_END_PANEL,
+    FRAME_OP_COUNT
+};
+
+struct FrameLabels {
+    mu_HashedLabel *items;
+    int count;
+};
+
+// Checks the ops of `code`, then runs them between `mu_begin` and `mu_end`
+// and stores the widget results, zeroing the slots of skipped widgets first.
+// Returns 0, or -1 without running anything when the code is malformed (an
+// unknown op, an op cut short, a label, slot or skip out of range, or a skip
+// that does not land on an op). Whether the BEGIN/END ops pair up is left to
+// the caller, as with direct calls.
+int run_frame_program(mu_Context *ctx, const int32_t *code, int len, FrameLabels labels, int32_t *results,
+                      int result_count);
+
+#endif
@@ -36,7 +36,7 @@
   } while (0)
 
 #define push(stk, val) do {                                                 \
-    expect((stk).idx < (int) (sizeof((stk).items) / sizeof(*(stk).items))); \
+    expect((stk).idx < (stk).size);                                         \
     (stk).items[(stk).idx] = (val);                                         \
     (stk).idx++; /* incremented after incase `val` uses this value */       \
   } while (0)
@@ -115,6 +115,11 @@ static int rect_overlaps_vec2(mu_Rect r, mu_Vec2 p) {
 }
 
 
+static char* chunk_items(mu_CommandChunk *chunk) {
+  return (char*) (chunk + 1);
+}
+
+
 static void draw_frame(mu_Context *ctx, mu_Rect rect, int colorid) {
   mu_draw_rect(ctx, rect, ctx->style->colors[colorid]);
   if (colorid == MU_COLOR_SCROLLBASE  ||
@@ -127,29 +132,203 @@ static void draw_frame(mu_Context *ctx, mu_Rect rect, int colorid) {
 }
 
 
+#define BLOCK_ALIGN 8
+/* input text buffers grown past this are freed at the end of the frame */
+#define INPUT_TEXT_KEEP 4096
+
+/* reserves `n` aligned bytes at `*offset`, returns the previous offset */
+static int carve(int *offset, int n) {
+  int res = *offset;
+  *offset += (n + BLOCK_ALIGN - 1) & ~(BLOCK_ALIGN - 1);
+  return res;
+}
+
+
+/* distinct across contexts, so a label measured by one context is measured
+** again by the next one that draws it */
+static unsigned text_epochs = 0;
+
+
 void mu_init(mu_Context *ctx) {
+  mu_init_ex(ctx, NULL);
+}
+
+
+void mu_init_ex(mu_Context *ctx, const mu_Capacity *cap) {
+  mu_Capacity c;
+  int size = 0;
+  int root_list, root_keys, container_stack, clip_stack, id_stack, layout_stack;
+  int container_pool, containers, treenode_pool, first_chunk;
+  int container_slots, treenode_slots, damage_roots, input_records;
+  char *block;
+
+  memset(&c, 0, sizeof(c));
+  if (cap) { c = *cap; }
+  if (c.command_bytes   <= 0) { c.command_bytes   = MU_COMMANDLIST_SIZE;    }
+  if (c.command_limit   == 0) { c.command_limit   = MU_COMMANDLIST_LIMIT;   }
+  if (c.root_list       <= 0) { c.root_list       = MU_ROOTLIST_SIZE;       }
+  if (c.container_stack <= 0) { c.container_stack = MU_CONTAINERSTACK_SIZE; }
+  if (c.clip_stack      <= 0) { c.clip_stack      = MU_CLIPSTACK_SIZE;      }
+  if (c.id_stack        <= 0) { c.id_stack        = MU_IDSTACK_SIZE;        }
+  if (c.layout_stack    <= 0) { c.layout_stack    = MU_LAYOUTSTACK_SIZE;    }
+  if (c.container_pool  <= 0) { c.container_pool  = MU_CONTAINERPOOL_SIZE;  }
+  if (c.treenode_pool   <= 0) { c.treenode_pool   = MU_TREENODEPOOL_SIZE;   }
+  if (c.input_queue     <= 0) { c.input_queue     = MU_INPUTQUEUE_SIZE;     }
+  { int n = 2; while (n < c.input_queue) { n <<= 1; } c.input_queue = n; }
+
+  /* lay out every stack, pool and the first command chunk in one block */
+  root_list       = carve(&size, c.root_list       * sizeof(mu_Container*));
+  root_keys       = carve(&size, c.root_list * 2   * sizeof(mu_RootKey));
+  container_stack = carve(&size, c.container_stack * sizeof(mu_Container*));
+  clip_stack      = carve(&size, c.clip_stack      * sizeof(mu_Rect));
+  id_stack        = carve(&size, c.id_stack        * sizeof(mu_Id));
+  layout_stack    = carve(&size, c.layout_stack    * sizeof(mu_Layout));
+  container_pool  = carve(&size, c.container_pool  * sizeof(mu_PoolItem));
+  containers      = carve(&size, c.container_pool  * sizeof(mu_Container));
+  treenode_pool   = carve(&size, c.treenode_pool   * sizeof(mu_PoolItem));
+  container_slots = carve(&size, mu_pool_slot_count(c.container_pool) * sizeof(int));
+  treenode_slots  = carve(&size, mu_pool_slot_count(c.treenode_pool)  * sizeof(int));
+  damage_roots    = carve(&size, c.root_list * 2 * sizeof(mu_DamageRoot));
+  input_records   = carve(&size, c.input_queue * MU_INPUT_WORDS * sizeof(int));
+  first_chunk     = carve(&size, sizeof(mu_CommandChunk) + c.command_bytes);
+  block = malloc(size);
+  expect(block != NULL);
+  memset(block, 0, size);
+
   memset(ctx, 0, sizeof(*ctx));
   ctx->draw_frame = draw_frame;
   ctx->_style = default_style;
   ctx->style = &ctx->_style;
+  ctx->block = block;
+  ctx->block_size = size;
+  ctx->root_list.items       = (mu_Container**) (block + root_list);
+  ctx->root_list.size        = c.root_list;
+  ctx->root_keys             = (mu_RootKey*) (block + root_keys);
+  ctx->container_stack.items = (mu_Container**) (block + container_stack);
+  ctx->container_stack.size  = c.container_stack;
+  ctx->clip_stack.items      = (mu_Rect*) (block + clip_stack);
+  ctx->clip_stack.size       = c.clip_stack;
+  ctx->id_stack.items        = (mu_Id*) (block + id_stack);
+  ctx->id_stack.size         = c.id_stack;
+  ctx->layout_stack.items    = (mu_Layout*) (block + layout_stack);
+  ctx->layout_stack.size     = c.layout_stack;
+  ctx->containers            = (mu_Container*) (block + containers);
+  mu_pool_setup(&ctx->container_pool, (mu_PoolItem*) (block + container_pool),
+    c.container_pool, (int*) (block + container_slots));
+  mu_pool_setup(&ctx->treenode_pool, (mu_PoolItem*) (block + treenode_pool),
+    c.treenode_pool, (int*) (block + treenode_slots));
+  ctx->damage.roots      = (mu_DamageRoot*) (block + damage_roots);
+  ctx->damage.prev_roots = ctx->damage.roots + c.root_list;
+  ctx->input_queue.records = (int*) (block + input_records);
+  ctx->input_queue.mask    = c.input_queue - 1;
+  ctx->command_list.first = (mu_CommandChunk*) (block + first_chunk);
+  ctx->command_list.first->size = c.command_bytes;
+  ctx->command_list.head = ctx->command_list.first;
+  ctx->command_list.capacity = c.command_bytes;
+  ctx->command_list.limit = c.command_limit > 0 ? c.command_limit : 0;
+  mu_text_metrics_changed(ctx);
+}
+
+
+void mu_deinit(mu_Context *ctx) {
+  mu_CommandChunk *chunk = ctx->command_list.head;
+  int i;
+  while (chunk) {
+    mu_CommandChunk *next = chunk->next;
+    if (chunk != ctx->command_list.first) { free(chunk); }
+    chunk = next;
+  }
+  free(ctx->damage.cmds);
+  free(ctx->damage.prev_cmds);
+  ctx->damage.cmds = ctx->damage.prev_cmds = NULL;
+  free(ctx->input_text.items);
+  ctx->input_text.items = NULL;
+  ctx->input_text.len = ctx->input_text.pos = ctx->input_text.size = 0;
+  for (i = 0; i < MU_TEXTLAYOUT_SIZE; i++) {
+    free(ctx->text_layouts[i].text);
+    free(ctx->text_layouts[i].lines);
+    memset(&ctx->text_layouts[i], 0, sizeof(mu_TextLayout));
+  }
+  free(ctx->block);
+  ctx->block = NULL;
+  ctx->command_list.head = ctx->command_list.chunk = NULL;
+  ctx->command_list.capacity = 0;
+}
+
+
+/* call after changing `text_width`, `text_height` or what they return for
+** the same font, so the widths cached in labels are measured again */
+void mu_text_metrics_changed(mu_Context *ctx) {
+  ctx->text_epoch = ++text_epochs;
 }
 
 
 void mu_begin(mu_Context *ctx) {
   expect(ctx->text_width && ctx->text_height);
+  mu_drain_input(ctx);
+  /* the first push starts over at the head chunk */
+  ctx->command_list.chunk = NULL;
+  ctx->command_list.ptr = ctx->command_list.end = NULL;
   ctx->command_list.idx = 0;
+  ctx->command_list.overflow = 0;
   ctx->root_list.idx = 0;
   ctx->scroll_target = NULL;
   ctx->hover_root = ctx->next_hover_root;
   ctx->next_hover_root = NULL;
   ctx->mouse_delta.x = ctx->mouse_pos.x - ctx->last_mouse_pos.x;
   ctx->mouse_delta.y = ctx->mouse_pos.y - ctx->last_mouse_pos.y;
+  ctx->input_dirty = 0;
   ctx->frame++;
 }
 
 
-static int compare_zindex(const void *a, const void *b) {
-  return (*(mu_Container**) a)->zindex - (*(mu_Container**) b)->zindex;
+static void track_damage(mu_Context *ctx);
+static void track_state(mu_Context *ctx);
+
+
+/* orders `keys` by zindex; in most frames they already are (roots keep being
+** begun in the same order and the z-order rarely changes), which costs one
+** pass. `tmp` has room for `n` keys */
+static void sort_roots(mu_RootKey *keys, mu_RootKey *tmp, int n) {
+  int i, j, shift, min, max;
+  unsigned diff;
+  for (i = 1; i < n && keys[i - 1].zindex <= keys[i].zindex; i++);
+  if (i == n) { return; }
+
+  /* short lists: insertion sort */
+  if (n <= 32) {
+    for (i = 1; i < n; i++) {
+      mu_RootKey k = keys[i];
+      for (j = i; j > 0 && keys[j - 1].zindex > k.zindex; j--) {
+        keys[j] = keys[j - 1];
+      }
+      keys[j] = k;
+    }
+    return;
+  }
+
+  /* long lists: LSD radix sort over the bytes in which the keys differ */
+  min = max = keys[0].zindex;
+  for (i = 1; i < n; i++) {
+    min = mu_min(min, keys[i].zindex);
+    max = mu_max(max, keys[i].zindex);
+  }
+  diff = (unsigned) max - (unsigned) min;
+  for (shift = 0; shift < 32 && (diff >> shift); shift += 8) {
+    int count[256];
+    mu_RootKey *t;
+    memset(count, 0, sizeof(count));
+    for (i = 0; i < n; i++) {
+      count[(((unsigned) keys[i].zindex - (unsigned) min) >> shift) & 0xff]++;
+    }
+    for (i = 0, j = 0; i < 256; i++) { int c = count[i]; count[i] = j; j += c; }
+    for (i = 0; i < n; i++) {
+      tmp[count[(((unsigned) keys[i].zindex - (unsigned) min) >> shift) & 0xff]++] = keys[i];
+    }
+    t = keys; keys = tmp; tmp = t;
+  }
+  /* an odd number of passes left the result in the caller's `tmp` */
+  if ((shift / 8) % 2) { memcpy(tmp, keys, n * sizeof(mu_RootKey)); }
 }
 
 
@@ -181,14 +360,28 @@ void mu_end(mu_Context *ctx) {
 
   /* reset input state */
   ctx->key_pressed = 0;
-  ctx->input_text[0] = '\0';
+  ctx->input_text.len = ctx->input_text.pos = 0;
+  if (ctx->input_text.items) { ctx->input_text.items[0] = '\0'; }
+  /* don't hold on to the memory of a big paste */
+  if (ctx->input_text.size > INPUT_TEXT_KEEP) {
+    free(ctx->input_text.items);
+    ctx->input_text.items = NULL;
+    ctx->input_text.size = 0;
+  }
   ctx->mouse_pressed = 0;
   ctx->scroll_delta = mu_vec2(0, 0);
   ctx->last_mouse_pos = ctx->mouse_pos;
 
   /* sort root containers by zindex */
   n = ctx->root_list.idx;
-  qsort(ctx->root_list.items, n, sizeof(mu_Container*), compare_zindex);
+  for (i = 0; i < n; i++) {
+    ctx->root_keys[i].zindex = ctx->root_list.items[i]->zindex;
+    ctx->root_keys[i].cnt = ctx->root_list.items[i];
+  }
+  sort_roots(ctx->root_keys, ctx->root_keys + ctx->root_list.size, n);
+  for (i = 0; i < n; i++) {
+    ctx->root_list.items[i] = ctx->root_keys[i].cnt;
+  }
 
   /* set root container jump commands */
   for (i = 0; i < n; i++) {
@@ -196,7 +389,7 @@ void mu_end(mu_Context *ctx) {
     /* if this is the first container then make the first command jump to it.
     ** otherwise set the previous container's tail to jump to this one */
     if (i == 0) {
-      mu_Command *cmd = (mu_Command*) ctx->command_list.items;
+      mu_Command *cmd = (mu_Command*) chunk_items(ctx->command_list.head);
       cmd->jump.dst = (char*) cnt->head + sizeof(mu_JumpCommand);
     } else {
       mu_Container *prev = ctx->root_list.items[i - 1];
@@ -204,9 +397,13 @@ void mu_end(mu_Context *ctx) {
     }
     /* make the last container's tail jump to the end of command list */
     if (i == n - 1) {
-      cnt->tail->jump.dst = ctx->command_list.items + ctx->command_list.idx;
+      cnt->tail->jump.dst = ctx->command_list.ptr;
     }
   }
+
+  /* let renderers skip or limit repainting, and schedulers skip frames */
+  track_damage(ctx);
+  track_state(ctx);
 }
 
 
@@ -216,9 +413,13 @@ void mu_set_focus(mu_Context *ctx, mu_Id id) {
 }
 
 
-/* 32bit fnv-1a hash */
 #define HASH_INITIAL 2166136261
 
+#ifdef MU_HASH_FNV1A
+
+/* 32bit fnv-1a hash, one byte per step. ids still chain the label's hash
+** rather than its bytes (see mu_get_id_hashed), so they differ from
+** upstream microui's */
 static void hash(mu_Id *hash, const void *data, int size) {
   const unsigned char *p = data;
   while (size--) {
@@ -226,16 +427,97 @@ static void hash(mu_Id *hash, const void *data, int size) {
   }
 }
 
+#else
 
-mu_Id mu_get_id(mu_Context *ctx, const void *data, int size) {
+/* murmur3-style 32bit hash taking a word per step: the multiplies on each
+** word are independent of the running hash, so only a xor, a rotate and a
+** multiply-add sit on the dependency chain. words are read with memcpy,
+** which compiles to a single unaligned load */
+#define hash_rotl(x, r) ((x) << (r) | (x) >> (32 - (r)))
+
+static void hash(mu_Id *hash, const void *data, int size) {
+  const unsigned char *p = data;
+  mu_Id h = *hash, k;
+  int n = size;
+  for (; n >= 4; n -= 4, p += 4) {
+    memcpy(&k, p, 4);
+    k *= 0xcc9e2d51; k = hash_rotl(k, 15); k *= 0x1b873593;
+    h ^= k; h = hash_rotl(h, 13); h = h * 5 + 0xe6546b64;
+  }
+  k = 0;
+  switch (n) {
+    case 3: k ^= (mu_Id) p[2] << 16; /* fallthrough */
+    case 2: k ^= (mu_Id) p[1] << 8;  /* fallthrough */
+    case 1: k ^= p[0];
+      k *= 0xcc9e2d51; k = hash_rotl(k, 15); k *= 0x1b873593;
+      h ^= k;
+  }
+  /* finalize so that short keys still reach every output bit */
+  h ^= (mu_Id) size;
+  h ^= h >> 16; h *= 0x85ebca6b;
+  h ^= h >> 13; h *= 0xc2b2ae35;
+  h ^= h >> 16;
+  *hash = h;
+}
+
+#endif
+
+
+mu_Id mu_hash_id(const void *data, int size) {
+  mu_Id res = HASH_INITIAL;
+  hash(&res, data, size);
+  return res;
+}
+
+
+/* an id is its label's hash mixed into the id on top of the stack, so a
+** label hashed once up front with mu_hash_id() yields the same id as
+** mu_get_id() on the label itself */
+mu_Id mu_get_id_hashed(mu_Context *ctx, mu_Id label_hash) {
   int idx = ctx->id_stack.idx;
   mu_Id res = (idx > 0) ? ctx->id_stack.items[idx - 1] : HASH_INITIAL;
-  hash(&res, data, size);
+  hash(&res, &label_hash, sizeof(label_hash));
   ctx->last_id = res;
   return res;
 }
 
 
+mu_Id mu_get_id(mu_Context *ctx, const void *data, int size) {
+  return mu_get_id_hashed(ctx, mu_hash_id(data, size));
+}
+
+
+void mu_push_id_hashed(mu_Context *ctx, mu_Id label_hash) {
+  push(ctx->id_stack, mu_get_id_hashed(ctx, label_hash));
+}
+
+
+mu_HashedLabel mu_hashed_label(const char *str, int len) {
+  mu_HashedLabel res;
+  if (len < 0) { len = strlen(str); }
+  res.str = str;
+  res.len = len;
+  res.hash = mu_hash_id(str, len);
+  res.font = NULL;
+  res.text_epoch = 0;
+  res.width = -1;
+  return res;
+}
+
+
+/* a label for text only, its hash is never read */
+static mu_HashedLabel text_label(const char *str) {
+  mu_HashedLabel res;
+  res.str = str;
+  res.len = strlen(str);
+  res.hash = 0;
+  res.font = NULL;
+  res.text_epoch = 0;
+  res.width = -1;
+  return res;
+}
+
+
 void mu_push_id(mu_Context *ctx, const void *data, int size) {
   push(ctx->id_stack, mu_get_id(ctx, data, size));
 }
@@ -310,16 +592,16 @@ mu_Container* mu_get_current_container(mu_Context *ctx) {
 static mu_Container* get_container(mu_Context *ctx, mu_Id id, int opt) {
   mu_Container *cnt;
   /* try to get existing container from pool */
-  int idx = mu_pool_get(ctx, ctx->container_pool, MU_CONTAINERPOOL_SIZE, id);
+  int idx = mu_pool_get(ctx, &ctx->container_pool, id);
   if (idx >= 0) {
     if (ctx->containers[idx].open || ~opt & MU_OPT_CLOSED) {
-      mu_pool_update(ctx, ctx->container_pool, idx);
+      mu_pool_update(ctx, &ctx->container_pool, idx);
     }
     return &ctx->containers[idx];
   }
   if (opt & MU_OPT_CLOSED) { return NULL; }
   /* container not found in pool: init new container */
-  idx = mu_pool_init(ctx, ctx->container_pool, MU_CONTAINERPOOL_SIZE, id);
+  idx = mu_pool_init(ctx, &ctx->container_pool, id);
   cnt = &ctx->containers[idx];
   memset(cnt, 0, sizeof(*cnt));
   cnt->open = 1;
@@ -343,33 +625,379 @@ void mu_bring_to_front(mu_Context *ctx, mu_Container *cnt) {
 ** pool
 **============================================================================*/
 
-int mu_pool_init(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id) {
-  int i, n = -1, f = ctx->frame;
+/* ids are already hashes, just fold the high bits into the mask */
+#define pool_home(pool, id) (((id) ^ ((id) >> 16)) & (pool)->slot_mask)
+
+
+int mu_pool_slot_count(int len) {
+  /* a power of two at least twice `len`, keeps probe runs short */
+  int n = 8;
+  while (n < len * 2) { n <<= 1; }
+  return n;
+}
+
+
+void mu_pool_setup(mu_Pool *pool, mu_PoolItem *items, int len, int *slots) {
+  int i;
+  pool->items = items;
+  pool->len = len;
+  pool->slots = slots;
+  pool->slot_mask = mu_pool_slot_count(len) - 1;
+  memset(slots, 0, (pool->slot_mask + 1) * sizeof(int));
+  /* every item starts out unused and equally old, in index order */
   for (i = 0; i < len; i++) {
-    if (items[i].last_update < f) {
-      f = items[i].last_update;
-      n = i;
-    }
+    items[i].id = 0;
+    items[i].last_update = 0;
+    items[i].prev = i - 1;
+    items[i].next = (i + 1 < len) ? i + 1 : -1;
   }
-  expect(n > -1);
-  items[n].id = id;
-  mu_pool_update(ctx, items, n);
+  pool->oldest = (len > 0) ? 0 : -1;
+  pool->newest = len - 1;
+}
+
+
+static void pool_unlink(mu_Pool *pool, int idx) {
+  mu_PoolItem *it = &pool->items[idx];
+  if (it->prev >= 0) { pool->items[it->prev].next = it->next; }
+                else { pool->oldest = it->next; }
+  if (it->next >= 0) { pool->items[it->next].prev = it->prev; }
+                else { pool->newest = it->prev; }
+}
+
+
+static void pool_link_newest(mu_Pool *pool, int idx) {
+  mu_PoolItem *it = &pool->items[idx];
+  it->prev = pool->newest;
+  it->next = -1;
+  if (pool->newest >= 0) { pool->items[pool->newest].next = idx; }
+                    else { pool->oldest = idx; }
+  pool->newest = idx;
+}
+
+
+static void pool_link_oldest(mu_Pool *pool, int idx) {
+  mu_PoolItem *it = &pool->items[idx];
+  it->prev = -1;
+  it->next = pool->oldest;
+  if (pool->oldest >= 0) { pool->items[pool->oldest].prev = idx; }
+                    else { pool->newest = idx; }
+  pool->oldest = idx;
+}
+
+
+/* returns the slot holding `id`, or the empty slot it would be put in */
+static int pool_find_slot(mu_Pool *pool, mu_Id id) {
+  int i = pool_home(pool, id);
+  while (pool->slots[i] && pool->items[pool->slots[i] - 1].id != id) {
+    i = (i + 1) & pool->slot_mask;
+  }
+  return i;
+}
+
+
+static void pool_unindex(mu_Pool *pool, int idx) {
+  int i, j, k;
+  if (pool->items[idx].id == 0) { return; }
+  i = j = pool_find_slot(pool, pool->items[idx].id);
+  if (pool->slots[i] != idx + 1) { return; }
+  pool->slots[i] = 0;
+  /* shift the rest of the probe run back so lookups never stop at the hole */
+  for (;;) {
+    j = (j + 1) & pool->slot_mask;
+    if (!pool->slots[j]) { break; }
+    k = pool_home(pool, pool->items[pool->slots[j] - 1].id);
+    /* entries whose home lies cyclically in (i, j] can stay */
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) { continue; }
+    pool->slots[i] = pool->slots[j];
+    pool->slots[j] = 0;
+    i = j;
+  }
+}
+
+
+int mu_pool_init(mu_Context *ctx, mu_Pool *pool, mu_Id id) {
+  /* the update list is ordered by `last_update`, so the first item is the
+  ** least recently used one; it can't be reused if it was updated this frame */
+  int n = pool->oldest;
+  expect(n > -1 && pool->items[n].last_update < ctx->frame);
+  pool_unindex(pool, n);
+  pool->items[n].id = id;
+  if (id) { pool->slots[pool_find_slot(pool, id)] = n + 1; }
+  mu_pool_update(ctx, pool, n);
   return n;
 }
 
 
-int mu_pool_get(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id) {
+int mu_pool_get(mu_Context *ctx, mu_Pool *pool, mu_Id id) {
   int i;
   unused(ctx);
-  for (i = 0; i < len; i++) {
-    if (items[i].id == id) { return i; }
+  if (id == 0) { return -1; }
+  i = pool_find_slot(pool, id);
+  return pool->slots[i] - 1;
+}
+
+
+void mu_pool_update(mu_Context *ctx, mu_Pool *pool, int idx) {
+  pool->items[idx].last_update = ctx->frame;
+  if (pool->newest != idx) {
+    pool_unlink(pool, idx);
+    pool_link_newest(pool, idx);
+  }
+}
+
+
+void mu_pool_remove(mu_Context *ctx, mu_Pool *pool, int idx) {
+  unused(ctx);
+  pool_unindex(pool, idx);
+  pool->items[idx].id = 0;
+  pool->items[idx].last_update = 0;
+  pool_unlink(pool, idx);
+  pool_link_oldest(pool, idx);
+}
+
+
+/*============================================================================
+** damage tracking
+**============================================================================*/
+
+/* FxHash style word mixing; every command is hashed every frame, so this
+** needs to be a lot cheaper than the bytewise id hash */
+#define frame_mix(h, w) ((h) = (((h) << 5 | (h) >> 27) ^ (w)) * 0x27d4eb2dU)
+
+/* hashes the raw command bytes; commands are fully written (text commands
+** clear their tail) and are read 16 bytes at a time into four lanes so the
+** multiplies don't wait on each other. Every command is at least 16 bytes,
+** the last block overlaps the previous one instead of being padded */
+static mu_Id hash_command(mu_Command *cmd) {
+  unsigned lane[4] = { HASH_INITIAL, 0x9e3779b9U, 0x85ebca6bU, 0xc2b2ae35U };
+  unsigned w[4];
+  const char *p = (const char*) cmd;
+  const char *last = p + cmd->base.size - sizeof(w);
+  for (;;) {
+    if (p > last) { p = last; }
+    memcpy(w, p, sizeof(w));
+    frame_mix(lane[0], w[0]);
+    frame_mix(lane[1], w[1]);
+    frame_mix(lane[2], w[2]);
+    frame_mix(lane[3], w[3]);
+    if (p == last) { break; }
+    p += sizeof(w);
   }
-  return -1;
+  return lane[0] ^ (lane[1] << 8 | lane[1] >> 24) ^
+         (lane[2] << 16 | lane[2] >> 16) ^ (lane[3] << 24 | lane[3] >> 8);
+}
+
+
+static int rects_touch(mu_Rect a, mu_Rect b) {
+  return a.x <= b.x + b.w && b.x <= a.x + a.w &&
+         a.y <= b.y + b.h && b.y <= a.y + a.h;
+}
+
+
+static mu_Rect union_rects(mu_Rect a, mu_Rect b) {
+  int x1 = mu_min(a.x, b.x);
+  int y1 = mu_min(a.y, b.y);
+  int x2 = mu_max(a.x + a.w, b.x + b.w);
+  int y2 = mu_max(a.y + a.h, b.y + b.h);
+  return mu_rect(x1, y1, x2 - x1, y2 - y1);
+}
+
+
+static int rects_equal(mu_Rect a, mu_Rect b) {
+  return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+
+static double rect_area(mu_Rect r) {
+  return (double) r.w * r.h;
+}
+
+
+static void add_damage(mu_Context *ctx, mu_Rect r) {
+  int i, best = 0;
+  double cost, best_cost = -1;
+  if (r.w <= 0 || r.h <= 0) { return; }
+  /* absorb every rect this one touches, the union may touch more */
+  for (i = 0; i < ctx->damage.count; i++) {
+    if (rects_touch(r, ctx->damage.rects[i])) {
+      r = union_rects(r, ctx->damage.rects[i]);
+      ctx->damage.rects[i] = ctx->damage.rects[--ctx->damage.count];
+      i = -1;
+    }
+  }
+  if (ctx->damage.count < MU_DAMAGE_MAX) {
+    ctx->damage.rects[ctx->damage.count++] = r;
+    return;
+  }
+  /* out of rects: merge with the one that grows the least */
+  for (i = 0; i < ctx->damage.count; i++) {
+    mu_Rect u = union_rects(r, ctx->damage.rects[i]);
+    cost = rect_area(u) - rect_area(ctx->damage.rects[i]);
+    if (best_cost < 0 || cost < best_cost) { best_cost = cost; best = i; }
+  }
+  r = union_rects(r, ctx->damage.rects[best]);
+  ctx->damage.rects[best] = ctx->damage.rects[--ctx->damage.count];
+  add_damage(ctx, r);
+}
+
+
+static void push_damage_cmd(mu_Context *ctx, mu_Id hash, mu_Rect rect) {
+  mu_DamageCmd *dc;
+  if (ctx->damage.cmd_count == ctx->damage.cmd_capacity) {
+    int n = ctx->damage.cmd_capacity ? ctx->damage.cmd_capacity * 2 : 256;
+    dc = realloc(ctx->damage.cmds, n * sizeof(mu_DamageCmd));
+    expect(dc != NULL);
+    ctx->damage.cmds = dc;
+    ctx->damage.cmd_capacity = n;
+  }
+  dc = &ctx->damage.cmds[ctx->damage.cmd_count++];
+  dc->hash = hash;
+  dc->rect = rect;
+}
+
+
+/* glyphs may paint this far outside the measured text box; renderers draw
+** and test TEXT commands with the same margin */
+#define TEXT_MARGIN 2
+
+
+/* records the hash and painted bounds of each command of a root container,
+** following the jumps that skip nested roots and link chunks */
+static void summarize_root(mu_Context *ctx, mu_Container *cnt, mu_DamageRoot *root) {
+  mu_Command *cmd = (mu_Command*) ((char*) cnt->head + sizeof(mu_JumpCommand));
+  mu_Rect clip = unclipped_rect;
+  root->cnt = cnt;
+  root->hash = HASH_INITIAL;
+  root->rect = mu_rect(0, 0, 0, 0);
+  root->first = ctx->damage.cmd_count;
+  while (cmd != cnt->tail) {
+    mu_Rect r = mu_rect(0, 0, 0, 0);
+    mu_Id h;
+    switch (cmd->type) {
+      case MU_COMMAND_JUMP: cmd = cmd->jump.dst; continue;
+      case MU_COMMAND_CLIP: clip = cmd->clip.rect; break;
+      case MU_COMMAND_RECT: r = intersect_rects(cmd->rect.rect, clip); break;
+      case MU_COMMAND_ICON: r = intersect_rects(cmd->icon.rect, clip); break;
+      case MU_COMMAND_TEXT:
+        r = mu_rect(cmd->text.pos.x - TEXT_MARGIN, cmd->text.pos.y - TEXT_MARGIN,
+                    cmd->text.size.x + 2 * TEXT_MARGIN,
+                    cmd->text.size.y + 2 * TEXT_MARGIN);
+        r = intersect_rects(r, clip);
+        break;
+    }
+    h = hash_command(cmd);
+    frame_mix(root->hash, h);
+    /* clip commands paint nothing, their effect shows in the later bounds */
+    if (r.w > 0 && r.h > 0) {
+      push_damage_cmd(ctx, h, r);
+      root->rect = root->rect.w ? union_rects(root->rect, r) : r;
+    }
+    cmd = (mu_Command*) ((char*) cmd + cmd->base.size);
+  }
+  root->count = ctx->damage.cmd_count - root->first;
+}
+
+
+/* damages whatever differs between the command runs of a root in the two
+** frames: the common prefix and suffix are kept, the rest is repainted */
+static void diff_root(mu_Context *ctx, mu_DamageRoot *old, mu_DamageRoot *cur) {
+  mu_DamageCmd *a = ctx->damage.prev_cmds + old->first;
+  mu_DamageCmd *b = ctx->damage.cmds + cur->first;
+  int m = old->count, n = cur->count, p = 0, s = 0, i;
+  while (p < m && p < n && a[p].hash == b[p].hash &&
+         rects_equal(a[p].rect, b[p].rect)) { p++; }
+  while (s < m - p && s < n - p && a[m - s - 1].hash == b[n - s - 1].hash &&
+         rects_equal(a[m - s - 1].rect, b[n - s - 1].rect)) { s++; }
+  for (i = p; i < m - s; i++) { add_damage(ctx, a[i].rect); }
+  for (i = p; i < n - s; i++) { add_damage(ctx, b[i].rect); }
+}
+
+
+static void track_damage(mu_Context *ctx) {
+  int i, j, n = ctx->root_list.idx;
+  mu_Id frame_hash = HASH_INITIAL;
+
+  /* this frame's summaries go where the ones from two frames ago were */
+  { mu_DamageRoot *t = ctx->damage.roots;
+    ctx->damage.roots = ctx->damage.prev_roots; ctx->damage.prev_roots = t; }
+  { mu_DamageCmd *t = ctx->damage.cmds;
+    ctx->damage.cmds = ctx->damage.prev_cmds; ctx->damage.prev_cmds = t; }
+  { int t = ctx->damage.cmd_capacity;
+    ctx->damage.cmd_capacity = ctx->damage.prev_cmd_capacity;
+    ctx->damage.prev_cmd_capacity = t; }
+  ctx->damage.prev_root_count = ctx->damage.root_count;
+  ctx->damage.prev_cmd_count = ctx->damage.cmd_count;
+  ctx->damage.root_count = n;
+  ctx->damage.cmd_count = 0;
+  ctx->damage.count = 0;
+  ctx->damage.base = ctx->frame_hash;
+
+  for (i = 0; i < n; i++) {
+    mu_DamageRoot *root = &ctx->damage.roots[i];
+    summarize_root(ctx, ctx->root_list.items[i], root);
+    frame_mix(frame_hash, root->hash);
+  }
+  ctx->frame_changed = (frame_hash != ctx->frame_hash);
+  ctx->frame_hash = frame_hash;
+  if (!ctx->frame_changed) { return; }
+
+  /* match roots by container; a root that changed its place in the z-order
+  ** may now cover or uncover others, so it is repainted as a whole */
+  for (i = 0; i < n; i++) {
+    mu_DamageRoot *cur = &ctx->damage.roots[i];
+    mu_DamageRoot *old = NULL;
+    int m = ctx->damage.prev_root_count;
+    /* mostly at the same place as last frame */
+    if (i < m && ctx->damage.prev_roots[i].cnt == cur->cnt) {
+      j = i;
+    } else {
+      for (j = 0; j < m && ctx->damage.prev_roots[j].cnt != cur->cnt; j++);
+    }
+    if (j < m) { old = &ctx->damage.prev_roots[j]; }
+    if (!old) {
+      add_damage(ctx, cur->rect);
+    } else if (j != i) {
+      add_damage(ctx, old->rect);
+      add_damage(ctx, cur->rect);
+    } else if (old->hash != cur->hash) {
+      diff_root(ctx, old, cur);
+    }
+    if (old) { old->cnt = NULL; }
+  }
+  /* roots that were not drawn this frame */
+  for (j = 0; j < ctx->damage.prev_root_count; j++) {
+    if (ctx->damage.prev_roots[j].cnt) {
+      add_damage(ctx, ctx->damage.prev_roots[j].rect);
+    }
+  }
+}
+
+
+/*============================================================================
+** frame scheduling
+**============================================================================*/
+
+/* hashes the retained state that the next frame reads but that need not
+** show in this frame's commands (e.g. focus, or a hover root that only
+** comes to the front a frame late) */
+static void track_state(mu_Context *ctx) {
+  mu_Id h = HASH_INITIAL;
+  hash(&h, &ctx->hover, sizeof(ctx->hover));
+  hash(&h, &ctx->focus, sizeof(ctx->focus));
+  hash(&h, &ctx->next_hover_root, sizeof(ctx->next_hover_root));
+  hash(&h, &ctx->last_zindex, sizeof(ctx->last_zindex));
+  hash(&h, &ctx->number_edit, sizeof(ctx->number_edit));
+  ctx->state_changed = (h != ctx->state_hash);
+  ctx->state_hash = h;
 }
 
 
-void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx) {
-  items[idx].last_update = ctx->frame;
+int mu_needs_frame(mu_Context *ctx) {
+  /* without new input a frame only differs from the last one while the ui
+  ** is still settling; application state changes are the caller's business */
+  return ctx->frame == 0 || ctx->input_dirty ||
+         ctx->input_queue.head != ctx->input_queue.tail ||
+         ctx->frame_changed || ctx->state_changed;
 }
 
 
@@ -378,6 +1006,7 @@ void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx) {
 **============================================================================*/
 
 void mu_input_mousemove(mu_Context *ctx, int x, int y) {
+  if (ctx->mouse_pos.x != x || ctx->mouse_pos.y != y) { ctx->input_dirty = 1; }
   ctx->mouse_pos = mu_vec2(x, y);
 }
 
@@ -386,37 +1015,188 @@ void mu_input_mousedown(mu_Context *ctx, int x, int y, int btn) {
   mu_input_mousemove(ctx, x, y);
   ctx->mouse_down |= btn;
   ctx->mouse_pressed |= btn;
+  ctx->input_dirty = 1;
 }
 
 
 void mu_input_mouseup(mu_Context *ctx, int x, int y, int btn) {
   mu_input_mousemove(ctx, x, y);
   ctx->mouse_down &= ~btn;
+  ctx->input_dirty = 1;
 }
 
 
 void mu_input_scroll(mu_Context *ctx, int x, int y) {
   ctx->scroll_delta.x += x;
   ctx->scroll_delta.y += y;
+  if (x || y) { ctx->input_dirty = 1; }
 }
 
 
 void mu_input_keydown(mu_Context *ctx, int key) {
   ctx->key_pressed |= key;
   ctx->key_down |= key;
+  ctx->input_dirty = 1;
 }
 
 
 void mu_input_keyup(mu_Context *ctx, int key) {
   ctx->key_down &= ~key;
+  ctx->input_dirty = 1;
 }
 
 
 void mu_input_text(mu_Context *ctx, const char *text) {
-  int len = strlen(ctx->input_text);
-  int size = strlen(text) + 1;
-  expect(len + size <= (int) sizeof(ctx->input_text));
-  memcpy(ctx->input_text + len, text, size);
+  int n = strlen(text);
+  char *dst;
+  /* past the limit keep what fits, without splitting a utf-8 sequence */
+  if (n > MU_INPUTTEXT_LIMIT - ctx->input_text.len) {
+    n = MU_INPUTTEXT_LIMIT - ctx->input_text.len;
+    while (n > 0 && (text[n] & 0xc0) == 0x80) { n--; }
+  }
+  dst = mu_input_text_reserve(ctx, n);
+  if (dst) {
+    memcpy(dst, text, n);
+    mu_input_text_commit(ctx, n);
+  }
+}
+
+
+/* returns room for `n` more bytes of text at the end of this frame's input
+** text, or NULL past MU_INPUTTEXT_LIMIT. Write at most `n` bytes, then call
+** `mu_input_text_commit` with the number written */
+char* mu_input_text_reserve(mu_Context *ctx, int n) {
+  int size = ctx->input_text.size;
+  if (n < 0 || n > MU_INPUTTEXT_LIMIT - ctx->input_text.len) { return NULL; }
+  if (ctx->input_text.len + n + 1 > size) {
+    char *items;
+    if (size == 0) { size = 64; }
+    while (ctx->input_text.len + n + 1 > size) { size *= 2; }
+    items = realloc(ctx->input_text.items, size);
+    expect(items != NULL);
+    ctx->input_text.items = items;
+    ctx->input_text.size = size;
+  }
+  return ctx->input_text.items + ctx->input_text.len;
+}
+
+
+void mu_input_text_commit(mu_Context *ctx, int n) {
+  if (n <= 0) { return; }
+  expect(ctx->input_text.len + n < ctx->input_text.size);
+  ctx->input_text.len += n;
+  ctx->input_text.items[ctx->input_text.len] = '\0';
+  ctx->input_dirty = 1;
+}
+
+
+/*============================================================================
+** input queue
+**============================================================================*/
+
+int mu_queue_input(mu_Context *ctx, int type, int a, int b, int c) {
+  mu_InputQueue *q = &ctx->input_queue;
+  int *rec, next = (q->head + 1) & q->mask;
+  /* fold runs of moves and scrolls into the newest unread record, so a fast
+  ** mouse can't crowd out the presses */
+  if (q->head != q->tail) {
+    rec = q->records + ((q->head - 1) & q->mask) * MU_INPUT_WORDS;
+    if (type == MU_INPUT_MOUSEMOVE && rec[0] == type) {
+      rec[1] = a; rec[2] = b;
+      return 1;
+    }
+    if (type == MU_INPUT_SCROLL && rec[0] == type) {
+      rec[1] += a; rec[2] += b;
+      return 1;
+    }
+  }
+  if (next == q->tail) { q->dropped++; return 0; }
+  rec = q->records + q->head * MU_INPUT_WORDS;
+  rec[0] = type; rec[1] = a; rec[2] = b; rec[3] = c;
+  q->head = next;
+  return 1;
+}
+
+
+int mu_queue_text(mu_Context *ctx, const char *text) {
+  mu_InputQueue *q = &ctx->input_queue;
+  int len = strlen(text);
+  while (len > 0) {
+    /* split between utf-8 sequences so each record holds whole characters */
+    int n = mu_min(len, 8);
+    int *rec, next = (q->head + 1) & q->mask;
+    while (n < len && n > 1 && (text[n] & 0xc0) == 0x80) { n--; }
+    if (next == q->tail) { q->dropped++; return 0; }
+    rec = q->records + q->head * MU_INPUT_WORDS;
+    rec[0] = MU_INPUT_TEXT;
+    rec[1] = n;
+    memcpy(rec + 2, text, n);
+    q->head = next;
+    text += n;
+    len -= n;
+  }
+  return 1;
+}
+
+
+/* applies queued records until one would hide an earlier one from this
+** frame: moves are coalesced, but a button or key changes state at most once
+** per frame and the mouse stays where a press or release happened. A press
+** or release somewhere else first moves the mouse there for a frame, since
+** controls only pick up hover while no button is down. The rest is left for
+** the next frame */
+int mu_drain_input(mu_Context *ctx) {
+  mu_InputQueue *q = &ctx->input_queue;
+  int n = 0, buttons = 0, keys = 0, moves = 0;
+  while (q->tail != q->head) {
+    int *rec = q->records + q->tail * MU_INPUT_WORDS;
+    int moved = (rec[1] != ctx->mouse_pos.x || rec[2] != ctx->mouse_pos.y);
+    switch (rec[0]) {
+      case MU_INPUT_MOUSEMOVE:
+        if (buttons && moved) { return n; }
+        moves |= moved;
+        mu_input_mousemove(ctx, rec[1], rec[2]);
+        break;
+      case MU_INPUT_MOUSEDOWN:
+      case MU_INPUT_MOUSEUP:
+        if ((buttons & rec[3]) || (buttons && moved)) { return n; }
+        if (moves || moved) {
+          mu_input_mousemove(ctx, rec[1], rec[2]);
+          return n;
+        }
+        buttons |= rec[3];
+        if (rec[0] == MU_INPUT_MOUSEDOWN) {
+          mu_input_mousedown(ctx, rec[1], rec[2], rec[3]);
+        } else {
+          mu_input_mouseup(ctx, rec[1], rec[2], rec[3]);
+        }
+        break;
+      case MU_INPUT_SCROLL:
+        mu_input_scroll(ctx, rec[1], rec[2]);
+        break;
+      case MU_INPUT_KEYDOWN:
+      case MU_INPUT_KEYUP:
+        if (keys & rec[1]) { return n; }
+        keys |= rec[1];
+        if (rec[0] == MU_INPUT_KEYDOWN) {
+          mu_input_keydown(ctx, rec[1]);
+        } else {
+          mu_input_keyup(ctx, rec[1]);
+        }
+        break;
+      case MU_INPUT_TEXT: {
+        int size = mu_clamp(rec[1], 0, 8);
+        char *dst = mu_input_text_reserve(ctx, size);
+        if (!dst) { return n; }
+        memcpy(dst, rec + 2, size);
+        mu_input_text_commit(ctx, size);
+        break;
+      }
+    }
+    q->tail = (q->tail + 1) & q->mask;
+    n++;
+  }
+  return n;
 }
 
 
@@ -424,23 +1204,76 @@ void mu_input_text(mu_Context *ctx, const char *text) {
 ** commandlist
 **============================================================================*/
 
+/* every chunk keeps room for the jump command linking it to the next one */
+#define CHUNK_RESERVE ((int) sizeof(mu_JumpCommand))
+
+static int next_chunk(mu_Context *ctx, int size) {
+  mu_CommandChunk *cur = ctx->command_list.chunk;
+  mu_CommandChunk *next = cur ? cur->next : ctx->command_list.head;
+  int needed = size + CHUNK_RESERVE;
+  if (!next || next->size < needed) {
+    /* grow: chunks double in size and are kept for the next frames */
+    mu_CommandChunk *chunk;
+    int chunk_size = cur ? cur->size * 2 : MU_COMMANDLIST_SIZE;
+    chunk_size = mu_max(chunk_size, needed);
+    chunk = malloc(sizeof(mu_CommandChunk) + chunk_size);
+    if (!chunk) { return 0; }
+    chunk->size = chunk_size;
+    chunk->next = next;
+    if (cur) { cur->next = chunk; } else { ctx->command_list.head = chunk; }
+    ctx->command_list.capacity += chunk_size;
+    next = chunk;
+  }
+  if (cur) {
+    mu_Command *jump = (mu_Command*) ctx->command_list.ptr;
+    jump->base.type = MU_COMMAND_JUMP;
+    jump->base.size = sizeof(mu_JumpCommand);
+    jump->jump.dst = chunk_items(next);
+    ctx->command_list.idx += sizeof(mu_JumpCommand);
+  }
+  ctx->command_list.chunk = next;
+  ctx->command_list.ptr = chunk_items(next);
+  ctx->command_list.end = chunk_items(next) + next->size - CHUNK_RESERVE;
+  return 1;
+}
+
+
 mu_Command* mu_push_command(mu_Context *ctx, int type, int size) {
-  mu_Command *cmd = (mu_Command*) (ctx->command_list.items + ctx->command_list.idx);
-  expect(ctx->command_list.idx + size < MU_COMMANDLIST_SIZE);
+  mu_Command *cmd;
+  /* jumps are exempt from the limit: dropping one would corrupt the list */
+  if (type != MU_COMMAND_JUMP && ctx->command_list.limit > 0 &&
+      ctx->command_list.idx + size > ctx->command_list.limit
+  ) {
+    ctx->command_list.overflow++;
+    return NULL;
+  }
+  if (!ctx->command_list.chunk ||
+      ctx->command_list.end - ctx->command_list.ptr < size
+  ) {
+    if (!next_chunk(ctx, size)) {
+      expect(type != MU_COMMAND_JUMP);
+      ctx->command_list.overflow++;
+      return NULL;
+    }
+  }
+  cmd = (mu_Command*) ctx->command_list.ptr;
   cmd->base.type = type;
   cmd->base.size = size;
+  ctx->command_list.ptr += size;
   ctx->command_list.idx += size;
   return cmd;
 }
 
 
 int mu_next_command(mu_Context *ctx, mu_Command **cmd) {
+  /* nothing was pushed this frame */
+  if (!ctx->command_list.chunk) { return 0; }
   if (*cmd) {
     *cmd = (mu_Command*) (((char*) *cmd) + (*cmd)->base.size);
   } else {
-    *cmd = (mu_Command*) ctx->command_list.items;
+    *cmd = (mu_Command*) chunk_items(ctx->command_list.head);
   }
-  while ((char*) *cmd != ctx->command_list.items + ctx->command_list.idx) {
+  while ((char*) *cmd != ctx->command_list.ptr) {
     if ((*cmd)->type != MU_COMMAND_JUMP) { return 1; }
     *cmd = (*cmd)->jump.dst;
   }
@@ -459,7 +1292,7 @@ static mu_Command* push_jump(mu_Context *ctx, mu_Command *dst) {
 void mu_set_clip(mu_Context *ctx, mu_Rect rect) {
   mu_Command *cmd;
   cmd = mu_push_command(ctx, MU_COMMAND_CLIP, sizeof(mu_ClipCommand));
-  cmd->clip.rect = rect;
+  if (cmd) { cmd->clip.rect = rect; }
 }
 
 
@@ -468,6 +1301,7 @@ void mu_draw_rect(mu_Context *ctx, mu_Rect rect, mu_Color color) {
   rect = intersect_rects(rect, mu_get_clip_rect(ctx));
   if (rect.w > 0 && rect.h > 0) {
     cmd = mu_push_command(ctx, MU_COMMAND_RECT, sizeof(mu_RectCommand));
+    if (!cmd) { return; }
     cmd->rect.rect = rect;
     cmd->rect.color = color;
   }
@@ -482,28 +1316,40 @@ void mu_draw_box(mu_Context *ctx, mu_Rect rect, mu_Color color) {
 }
 
 
-void mu_draw_text(mu_Context *ctx, mu_Font font, const char *str, int len,
-  mu_Vec2 pos, mu_Color color)
+/* `rect` is where the text goes, already measured */
+static void push_text(mu_Context *ctx, mu_Font font, const char *str, int len,
+  mu_Rect rect, mu_Color color)
 {
   mu_Command *cmd;
-  mu_Rect rect = mu_rect(
-    pos.x, pos.y, ctx->text_width(font, str, len), ctx->text_height(font));
   int clipped = mu_check_clip(ctx, rect);
   if (clipped == MU_CLIP_ALL ) { return; }
   if (clipped == MU_CLIP_PART) { mu_set_clip(ctx, mu_get_clip_rect(ctx)); }
   /* add command */
   if (len < 0) { len = strlen(str); }
   cmd = mu_push_command(ctx, MU_COMMAND_TEXT, sizeof(mu_TextCommand) + len);
-  memcpy(cmd->text.str, str, len);
-  cmd->text.str[len] = '\0';
-  cmd->text.pos = pos;
-  cmd->text.color = color;
-  cmd->text.font = font;
+  if (cmd) {
+    memcpy(cmd->text.str, str, len);
+    /* terminate and clear the struct padding too, `hash_commands` reads it */
+    memset(cmd->text.str + len, 0, (char*) cmd + cmd->base.size - (cmd->text.str + len));
+    cmd->text.pos = mu_vec2(rect.x, rect.y);
+    cmd->text.size = mu_vec2(rect.w, rect.h);
+    cmd->text.color = color;
+    cmd->text.font = font;
+  }
   /* reset clipping if it was set */
   if (clipped) { mu_set_clip(ctx, unclipped_rect); }
 }
 
 
+void mu_draw_text(mu_Context *ctx, mu_Font font, const char *str, int len,
+  mu_Vec2 pos, mu_Color color)
+{
+  mu_Rect rect = mu_rect(
+    pos.x, pos.y, ctx->text_width(font, str, len), ctx->text_height(font));
+  push_text(ctx, font, str, len, rect, color);
+}
+
+
 void mu_draw_icon(mu_Context *ctx, int id, mu_Rect rect, mu_Color color) {
   mu_Command *cmd;
   /* do clip command if the rect isn't fully contained within the cliprect */
@@ -512,9 +1358,11 @@ void mu_draw_icon(mu_Context *ctx, int id, mu_Rect rect, mu_Color color) {
   if (clipped == MU_CLIP_PART) { mu_set_clip(ctx, mu_get_clip_rect(ctx)); }
   /* do icon command */
   cmd = mu_push_command(ctx, MU_COMMAND_ICON, sizeof(mu_IconCommand));
-  cmd->icon.id = id;
-  cmd->icon.rect = rect;
-  cmd->icon.color = color;
+  if (cmd) {
+    cmd->icon.id = id;
+    cmd->icon.rect = rect;
+    cmd->icon.color = color;
+  }
   /* reset clipping if it was set */
   if (clipped) { mu_set_clip(ctx, unclipped_rect); }
 }
@@ -649,26 +1497,42 @@ void mu_draw_control_frame(mu_Context *ctx, mu_Id id, mu_Rect rect,
 }
 
 
-void mu_draw_control_text(mu_Context *ctx, const char *str, mu_Rect rect,
-  int colorid, int opt)
+/* measures the label unless its cached width is for the current font */
+static void draw_label_text(mu_Context *ctx, mu_HashedLabel *label,
+  mu_Rect rect, int colorid, int opt)
 {
-  mu_Vec2 pos;
+  mu_Rect tr;
   mu_Font font = ctx->style->font;
-  int tw = ctx->text_width(font, str, -1);
+  if (label->width < 0 || label->font != font ||
+      label->text_epoch != ctx->text_epoch) {
+    label->width = ctx->text_width(font, label->str, label->len);
+    label->font = font;
+    label->text_epoch = ctx->text_epoch;
+  }
   mu_push_clip_rect(ctx, rect);
-  pos.y = rect.y + (rect.h - ctx->text_height(font)) / 2;
+  tr.w = label->width;
+  tr.h = ctx->text_height(font);
+  tr.y = rect.y + (rect.h - tr.h) / 2;
   if (opt & MU_OPT_ALIGNCENTER) {
-    pos.x = rect.x + (rect.w - tw) / 2;
+    tr.x = rect.x + (rect.w - tr.w) / 2;
   } else if (opt & MU_OPT_ALIGNRIGHT) {
-    pos.x = rect.x + rect.w - tw - ctx->style->padding;
+    tr.x = rect.x + rect.w - tr.w - ctx->style->padding;
   } else {
-    pos.x = rect.x + ctx->style->padding;
+    tr.x = rect.x + ctx->style->padding;
   }
-  mu_draw_text(ctx, font, str, -1, pos, ctx->style->colors[colorid]);
+  push_text(ctx, font, label->str, label->len, tr, ctx->style->colors[colorid]);
   mu_pop_clip_rect(ctx);
 }
 
 
+void mu_draw_control_text(mu_Context *ctx, const char *str, mu_Rect rect,
+  int colorid, int opt)
+{
+  mu_HashedLabel label = text_label(str);
+  draw_label_text(ctx, &label, rect, colorid, opt);
+}
+
+
 int mu_mouse_over(mu_Context *ctx, mu_Rect rect) {
   return rect_overlaps_vec2(rect, ctx->mouse_pos) &&
     rect_overlaps_vec2(mu_get_clip_rect(ctx), ctx->mouse_pos) &&
@@ -698,28 +1562,167 @@ void mu_update_control(mu_Context *ctx, mu_Id id, mu_Rect rect, int opt) {
 }
 
 
-void mu_text(mu_Context *ctx, const char *text) {
+/* the hash of a `mu_text` string is taken a word at a time, and the hash of
+** any prefix can be finished on the way with `hash_text_tail` */
+static mu_Id hash_text_words(mu_Id h, const char *p, int n) {
+  unsigned w;
+  for (; n >= 4; n -= 4, p += 4) {
+    memcpy(&w, p, sizeof(w));
+    frame_mix(h, w);
+  }
+  return h;
+}
+
+
+/* `p` points past the whole words of a `len` bytes prefix */
+static mu_Id hash_text_tail(mu_Id h, const char *p, int len) {
+  unsigned w = 0;
+  memcpy(&w, p, len & 3);
+  frame_mix(h, w);
+  frame_mix(h, (unsigned) len);
+  return h;
+}
+
+
+static void push_text_line(mu_TextLayout *tl, int start, int len, int width) {
+  mu_TextLine *line;
+  if (tl->line_count == tl->line_capacity) {
+    int n = tl->line_capacity ? tl->line_capacity * 2 : 16;
+    line = realloc(tl->lines, n * sizeof(mu_TextLine));
+    expect(line != NULL);
+    tl->lines = line;
+    tl->line_capacity = n;
+  }
+  line = &tl->lines[tl->line_count++];
+  line->start = start;
+  line->len = len;
+  line->width = width;
+}
+
+
+/* wraps `text` from the start of the last line in `tl` on; every line only
+** depends on where it starts, so the lines before it stay valid when text
+** was appended */
+static void wrap_text(mu_Context *ctx, mu_TextLayout *tl, const char *text) {
   const char *start, *end, *p = text;
-  int width = -1;
-  mu_Font font = ctx->style->font;
-  mu_Color color = ctx->style->colors[MU_COLOR_TEXT];
-  mu_layout_begin_column(ctx);
-  mu_layout_row(ctx, 1, &width, ctx->text_height(font));
+  if (tl->line_count > 0) { p = text + tl->lines[--tl->line_count].start; }
   do {
-    mu_Rect r = mu_layout_next(ctx);
     int w = 0;
     start = end = p;
     do {
       const char* word = p;
       while (*p && *p != ' ' && *p != '\n') { p++; }
-      w += ctx->text_width(font, word, p - word);
-      if (w > r.w && end != start) { break; }
-      w += ctx->text_width(font, p, 1);
+      w += ctx->text_width(tl->font, word, p - word);
+      if (w > tl->width && end != start) { break; }
+      w += ctx->text_width(tl->font, p, 1);
       end = p++;
     } while (*end && *end != '\n');
-    mu_draw_text(ctx, font, start, end - start, mu_vec2(r.x, r.y), color);
+    push_text_line(tl, start - text, end - start,
+      ctx->text_width(tl->font, start, end - start));
     p = end + 1;
   } while (*end);
+}
+
+
+static mu_TextLayout* get_text_layout(mu_Context *ctx, const char *text,
+  mu_Font font, int width)
+{
+  mu_TextLayout *cand[MU_TEXTLAYOUT_SIZE], *found = NULL, *res;
+  int i, j, n = 0, pos = 0, len = strlen(text);
+  mu_Id h = HASH_INITIAL;
+
+  /* collect the layouts that may hold a prefix of `text`, shortest first */
+  for (i = 0; i < MU_TEXTLAYOUT_SIZE; i++) {
+    mu_TextLayout *tl = &ctx->text_layouts[i];
+    if (tl->line_count > 0 && tl->font == font && tl->width == width &&
+        tl->text_epoch == ctx->text_epoch && tl->len <= len) {
+      for (j = n++; j > 0 && cand[j - 1]->len > tl->len; j--) { cand[j] = cand[j - 1]; }
+      cand[j] = tl;
+    }
+  }
+
+  /* hash `text` once, checking the prefix of every candidate on the way; a
+  ** matching hash is confirmed against the bytes */
+  for (i = 0; i < n; i++) {
+    int end = cand[i]->len & ~3;
+    h = hash_text_words(h, text + pos, end - pos);
+    pos = end;
+    if (hash_text_tail(h, text + pos, cand[i]->len) == cand[i]->hash &&
+        memcmp(cand[i]->text, text, cand[i]->len) == 0) {
+      found = cand[i];
+    }
+  }
+  h = hash_text_words(h, text + pos, (len & ~3) - pos);
+  h = hash_text_tail(h, text + (len & ~3), len);
+
+  if (found && found->len == len) {
+    found->last_update = ctx->frame;
+    return found;
+  }
+
+  /* take the least recently used layout, unless the text grew from `found`
+  ** and nothing else drew that this frame */
+  res = found;
+  if (!found || found->last_update == ctx->frame) {
+    res = &ctx->text_layouts[0];
+    for (i = 1; i < MU_TEXTLAYOUT_SIZE; i++) {
+      if (ctx->text_layouts[i].last_update < res->last_update) { res = &ctx->text_layouts[i]; }
+    }
+    res->font = font;
+    res->text_epoch = ctx->text_epoch;
+    res->width = width;
+    res->line_count = 0;
+    if (found && found != res) {
+      for (i = 0; i < found->line_count; i++) {
+        mu_TextLine *line = &found->lines[i];
+        push_text_line(res, line->start, line->len, line->width);
+      }
+    }
+  }
+  wrap_text(ctx, res, text);
+  if (res->text_capacity < len + 1) {
+    char *copy = realloc(res->text, len + 1);
+    expect(copy != NULL);
+    res->text = copy;
+    res->text_capacity = len + 1;
+  }
+  memcpy(res->text, text, len + 1);
+  res->hash = h;
+  res->len = len;
+  res->last_update = ctx->frame;
+  return res;
+}
+
+
+void mu_text(mu_Context *ctx, const char *text) {
+  mu_Font font = ctx->style->font;
+  mu_Color color = ctx->style->colors[MU_COLOR_TEXT];
+  int width = -1, height = ctx->text_height(font);
+  int pitch = height + ctx->style->spacing;
+  int i, first, last;
+  mu_Rect r, clip = mu_get_clip_rect(ctx);
+  mu_TextLayout *tl;
+  mu_Layout *layout;
+  mu_layout_begin_column(ctx);
+  mu_layout_row(ctx, 1, &width, height);
+  r = mu_layout_next(ctx);
+  tl = get_text_layout(ctx, text, font, r.w);
+  /* draw the lines touching the clip rect only */
+  first = clip.y - r.y - height > 0 ? (clip.y - r.y - height) / pitch : 0;
+  last = clip.y + clip.h - r.y >= 0 ? (clip.y + clip.h - r.y) / pitch + 1 : 0;
+  last = mu_min(last, tl->line_count);
+  for (i = first; i < last; i++) {
+    mu_TextLine *line = &tl->lines[i];
+    push_text(ctx, font, text + line->start, line->len,
+      mu_rect(r.x, r.y + i * pitch, line->width, height), color);
+  }
+  /* move past every line, as `mu_layout_next` would have */
+  layout = get_layout(ctx);
+  r.y += (tl->line_count - 1) * pitch;
+  r.h = height;
+  layout->next_row = r.y - layout->body.y + pitch;
+  layout->max.y = mu_max(layout->max.y, r.y + r.h);
+  ctx->last_rect = r;
   mu_layout_end_column(ctx);
 }
 
@@ -729,9 +1732,22 @@ void mu_label(mu_Context *ctx, const char *text) {
 }
 
 
+void mu_label_hashed(mu_Context *ctx, mu_HashedLabel *label) {
+  draw_label_text(ctx, label, mu_layout_next(ctx), MU_COLOR_TEXT, 0);
+}
+
+
 int mu_button_ex(mu_Context *ctx, const char *label, int icon, int opt) {
+  mu_HashedLabel l;
+  if (!label) { return mu_button_hashed(ctx, NULL, icon, opt); }
+  l = mu_hashed_label(label, -1);
+  return mu_button_hashed(ctx, &l, icon, opt);
+}
+
+
+int mu_button_hashed(mu_Context *ctx, mu_HashedLabel *label, int icon, int opt) {
   int res = 0;
-  mu_Id id = label ? mu_get_id(ctx, label, strlen(label))
+  mu_Id id = label ? mu_get_id_hashed(ctx, label->hash)
                    : mu_get_id(ctx, &icon, sizeof(icon));
   mu_Rect r = mu_layout_next(ctx);
   mu_update_control(ctx, id, r, opt);
@@ -741,13 +1757,19 @@ int mu_button_ex(mu_Context *ctx, const char *label, int icon, int opt) {
   }
   /* draw */
   mu_draw_control_frame(ctx, id, r, MU_COLOR_BUTTON, opt);
-  if (label) { mu_draw_control_text(ctx, label, r, MU_COLOR_TEXT, opt); }
+  if (label) { draw_label_text(ctx, label, r, MU_COLOR_TEXT, opt); }
   if (icon) { mu_draw_icon(ctx, icon, r, ctx->style->colors[MU_COLOR_TEXT]); }
   return res;
 }
 
 
 int mu_checkbox(mu_Context *ctx, const char *label, int *state) {
+  mu_HashedLabel l = text_label(label);
+  return mu_checkbox_hashed(ctx, &l, state);
+}
+
+
+int mu_checkbox_hashed(mu_Context *ctx, mu_HashedLabel *label, int *state) {
   int res = 0;
   mu_Id id = mu_get_id(ctx, &state, sizeof(state));
   mu_Rect r = mu_layout_next(ctx);
@@ -764,7 +1786,7 @@ int mu_checkbox(mu_Context *ctx, const char *label, int *state) {
     mu_draw_icon(ctx, MU_ICON_CHECK, box, ctx->style->colors[MU_COLOR_TEXT]);
   }
   r = mu_rect(r.x + box.w, r.y, r.w - box.w, r.h);
-  mu_draw_control_text(ctx, label, r, MU_COLOR_TEXT, 0);
+  draw_label_text(ctx, label, r, MU_COLOR_TEXT, 0);
   return res;
 }
 
@@ -777,10 +1799,18 @@ int mu_textbox_raw(mu_Context *ctx, char *buf, int bufsz, mu_Id id, mu_Rect r,
 
   if (ctx->focus == id) {
     /* handle text input */
+    const char *text = ctx->input_text.items ?
+      ctx->input_text.items + ctx->input_text.pos : "";
+    int avail = ctx->input_text.len - ctx->input_text.pos;
     int len = strlen(buf);
-    int n = mu_min(bufsz - len - 1, (int) strlen(ctx->input_text));
+    int n = mu_min(bufsz - len - 1, avail);
+    /* take what fits, without splitting a utf-8 sequence */
+    if (n < avail) {
+      while (n > 0 && (text[n] & 0xc0) == 0x80) { n--; }
+    }
     if (n > 0) {
-      memcpy(buf + len, ctx->input_text, n);
+      memcpy(buf + len, text, n);
+      ctx->input_text.pos += n;
       len += n;
       buf[len] = '\0';
       res |= MU_RES_CHANGE;
@@ -923,11 +1953,13 @@ int mu_number_ex(mu_Context *ctx, mu_Real *value, mu_Real step,
 }
 
 
-static int header(mu_Context *ctx, const char *label, int istreenode, int opt) {
+static int header(mu_Context *ctx, mu_HashedLabel *label, int istreenode,
+  int opt)
+{
   mu_Rect r;
   int active, expanded;
-  mu_Id id = mu_get_id(ctx, label, strlen(label));
-  int idx = mu_pool_get(ctx, ctx->treenode_pool, MU_TREENODEPOOL_SIZE, id);
+  mu_Id id = mu_get_id_hashed(ctx, label->hash);
+  int idx = mu_pool_get(ctx, &ctx->treenode_pool, id);
   int width = -1;
   mu_layout_row(ctx, 1, &width, 0);
 
@@ -941,10 +1973,10 @@ static int header(mu_Context *ctx, const char *label, int istreenode, int opt) {
 
   /* update pool ref */
   if (idx >= 0) {
-    if (active) { mu_pool_update(ctx, ctx->treenode_pool, idx); }
-           else { memset(&ctx->treenode_pool[idx], 0, sizeof(mu_PoolItem)); }
+    if (active) { mu_pool_update(ctx, &ctx->treenode_pool, idx); }
+           else { mu_pool_remove(ctx, &ctx->treenode_pool, idx); }
   } else if (active) {
-    mu_pool_init(ctx, ctx->treenode_pool, MU_TREENODEPOOL_SIZE, id);
+    mu_pool_init(ctx, &ctx->treenode_pool, id);
   }
 
   /* draw */
@@ -958,18 +1990,30 @@ static int header(mu_Context *ctx, const char *label, int istreenode, int opt) {
     mu_rect(r.x, r.y, r.h, r.h), ctx->style->colors[MU_COLOR_TEXT]);
   r.x += r.h - ctx->style->padding;
   r.w -= r.h - ctx->style->padding;
-  mu_draw_control_text(ctx, label, r, MU_COLOR_TEXT, 0);
+  draw_label_text(ctx, label, r, MU_COLOR_TEXT, 0);
 
   return expanded ? MU_RES_ACTIVE : 0;
 }
 
 
 int mu_header_ex(mu_Context *ctx, const char *label, int opt) {
+  mu_HashedLabel l = mu_hashed_label(label, -1);
+  return header(ctx, &l, 0, opt);
+}
+
+
+int mu_header_hashed(mu_Context *ctx, mu_HashedLabel *label, int opt) {
   return header(ctx, label, 0, opt);
 }
 
 
 int mu_begin_treenode_ex(mu_Context *ctx, const char *label, int opt) {
+  mu_HashedLabel l = mu_hashed_label(label, -1);
+  return mu_begin_treenode_hashed(ctx, &l, opt);
+}
+
+
+int mu_begin_treenode_hashed(mu_Context *ctx, mu_HashedLabel *label, int opt) {
   int res = header(ctx, label, 1, opt);
   if (res & MU_RES_ACTIVE) {
     get_layout(ctx)->indent += ctx->style->indent;
@@ -1073,7 +2117,7 @@ static void end_root_container(mu_Context *ctx) {
   ** on initing these are done in mu_end() */
   mu_Container *cnt = mu_get_current_container(ctx);
   cnt->tail = push_jump(ctx, NULL);
-  cnt->head->jump.dst = ctx->command_list.items + ctx->command_list.idx;
+  cnt->head->jump.dst = ctx->command_list.ptr;
   /* pop base clip rect and container */
   mu_pop_clip_rect(ctx);
   pop_container(ctx);
@@ -1081,8 +2125,16 @@ static void end_root_container(mu_Context *ctx) {
 
 
 int mu_begin_window_ex(mu_Context *ctx, const char *title, mu_Rect rect, int opt) {
+  mu_HashedLabel l = mu_hashed_label(title, -1);
+  return mu_begin_window_hashed(ctx, &l, rect, opt);
+}
+
+
+int mu_begin_window_hashed(mu_Context *ctx, mu_HashedLabel *title, mu_Rect rect,
+  int opt)
+{
   mu_Rect body;
-  mu_Id id = mu_get_id(ctx, title, strlen(title));
+  mu_Id id = mu_get_id_hashed(ctx, title->hash);
   mu_Container *cnt = get_container(ctx, id, opt);
   if (!cnt || !cnt->open) { return 0; }
   push(ctx->id_stack, id);
@@ -1106,7 +2158,7 @@ int mu_begin_window_ex(mu_Context *ctx, const char *title, mu_Rect rect, int opt
     if (~opt & MU_OPT_NOTITLE) {
       mu_Id id = mu_get_id(ctx, "!title", 6);
       mu_update_control(ctx, id, tr, opt);
-      mu_draw_control_text(ctx, title, tr, MU_COLOR_TITLETEXT, opt);
+      draw_label_text(ctx, title, tr, MU_COLOR_TITLETEXT, opt);
       if (id == ctx->focus && ctx->mouse_down == MU_MOUSE_LEFT) {
         cnt->rect.x += ctx->mouse_delta.x;
         cnt->rect.y += ctx->mouse_delta.y;
@@ -1166,7 +2218,13 @@ void mu_end_window(mu_Context *ctx) {
 
 
 void mu_open_popup(mu_Context *ctx, const char *name) {
-  mu_Container *cnt = mu_get_container(ctx, name);
+  mu_HashedLabel l = mu_hashed_label(name, -1);
+  mu_open_popup_hashed(ctx, &l);
+}
+
+
+void mu_open_popup_hashed(mu_Context *ctx, mu_HashedLabel *name) {
+  mu_Container *cnt = get_container(ctx, mu_get_id_hashed(ctx, name->hash), 0);
   /* set as hover root so popup isn't closed in begin_window_ex()  */
   ctx->hover_root = ctx->next_hover_root = cnt;
   /* position at mouse cursor, open and bring-to-front */
@@ -1177,9 +2235,15 @@ void mu_open_popup(mu_Context *ctx, const char *name) {
 
 
 int mu_begin_popup(mu_Context *ctx, const char *name) {
+  mu_HashedLabel l = mu_hashed_label(name, -1);
+  return mu_begin_popup_hashed(ctx, &l);
+}
+
+
+int mu_begin_popup_hashed(mu_Context *ctx, mu_HashedLabel *name) {
   int opt = MU_OPT_POPUP | MU_OPT_AUTOSIZE | MU_OPT_NORESIZE |
             MU_OPT_NOSCROLL | MU_OPT_NOTITLE | MU_OPT_CLOSED;
-  return mu_begin_window_ex(ctx, name, mu_rect(0, 0, 0, 0), opt);
+  return mu_begin_window_hashed(ctx, name, mu_rect(0, 0, 0, 0), opt);
 }
 
 
@@ -1189,8 +2253,14 @@ void mu_end_popup(mu_Context *ctx) {
 
 
 void mu_begin_panel_ex(mu_Context *ctx, const char *name, int opt) {
+  mu_HashedLabel l = mu_hashed_label(name, -1);
+  mu_begin_panel_hashed(ctx, &l, opt);
+}
+
+
+void mu_begin_panel_hashed(mu_Context *ctx, mu_HashedLabel *name, int opt) {
   mu_Container *cnt;
-  mu_push_id(ctx, name, strlen(name));
+  mu_push_id_hashed(ctx, name->hash);
   cnt = get_container(ctx, ctx->last_id, opt);
   cnt->rect = mu_layout_next(ctx);
   if (~opt & MU_OPT_NOFRAME) {
@@ -1206,3 +2276,41 @@ void mu_end_panel(mu_Context *ctx) {
   mu_pop_clip_rect(ctx);
   pop_container(ctx);
 }
+
+
+/* Lays out `count` rows of `row_height` but only visits the ones inside the
+** current clip rect: the caller draws rows `list->first` to `list->last - 1`,
+** one layout row each. The skipped rows still count towards the content size,
+** so the scrollbars behave as if every row was there. A row that turns out
+** taller than `row_height` is fine, the height is only used as an estimate
+** for the rows that are not visited. */
+void mu_begin_virtual_list(mu_Context *ctx, mu_VirtualList *list, int count, int row_height) {
+  mu_Layout *layout = get_layout(ctx);
+  mu_Rect clip = mu_get_clip_rect(ctx);
+  int top;
+  if (row_height <= 0) { row_height = ctx->style->size.y + ctx->style->padding * 2; }
+  list->count = mu_max(count, 0);
+  list->pitch = row_height + ctx->style->spacing;
+  list->start = layout->next_row;
+  /* visible span relative to the first row */
+  top = clip.y - layout->body.y - list->start;
+  list->first = mu_clamp(top / list->pitch, 0, list->count);
+  list->last = mu_clamp((top + clip.h + list->pitch - 1) / list->pitch,
+    list->first, list->count);
+  /* skip the rows above the visible range */
+  layout->next_row = list->start + list->first * list->pitch;
+  mu_layout_row(ctx, layout->items, NULL, row_height);
+}
+
+
+void mu_end_virtual_list(mu_Context *ctx, mu_VirtualList *list) {
+  mu_Layout *layout = get_layout(ctx);
+  int end = mu_max(layout->next_row, list->start + list->last * list->pitch);
+  /* account for the rows below the visible range */
+  end += (list->count - list->last) * list->pitch;
+  if (list->count > 0) {
+    layout->max.y = mu_max(layout->max.y, layout->body.y + end - ctx->style->spacing);
+  }
+  layout->next_row = end;
+  mu_layout_row(ctx, layout->items, NULL, layout->size.y);
+}
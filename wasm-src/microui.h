@@ -10,21 +10,26 @@
 
 #define MU_VERSION "2.01"
 
-#define MU_COMMANDLIST_SIZE     (256 * 1024)
-#define MU_ROOTLIST_SIZE        32
+#define MU_COMMANDLIST_SIZE     (64 * 1024)
+#define MU_COMMANDLIST_LIMIT    (64 * 1024 * 1024)
+#define MU_ROOTLIST_SIZE        256
 #define MU_CONTAINERSTACK_SIZE  32
 #define MU_CLIPSTACK_SIZE       32
 #define MU_IDSTACK_SIZE         32
 #define MU_LAYOUTSTACK_SIZE     16
 #define MU_CONTAINERPOOL_SIZE   48
 #define MU_TREENODEPOOL_SIZE    48
+#define MU_INPUTQUEUE_SIZE      256
+#define MU_INPUTTEXT_LIMIT      (1024 * 1024)
 #define MU_MAX_WIDTHS           16
+#define MU_DAMAGE_MAX           16
+#define MU_TEXTLAYOUT_SIZE      16
 #define MU_REAL                 float
 #define MU_REAL_FMT             "%.3g"
 #define MU_SLIDER_FMT           "%.2f"
 #define MU_MAX_FMT              127
 
-#define mu_stack(T, n)          struct { int idx; T items[n]; }
+#define mu_stack(T)             struct { int idx, size; T *items; }
 #define mu_min(a, b)            ((a) < (b) ? (a) : (b))
 #define mu_max(a, b)            ((a) > (b) ? (a) : (b))
 #define mu_clamp(x, a, b)       mu_min(b, mu_max(a, x))
@@ -105,6 +110,23 @@ enum {
   MU_KEY_RETURN       = (1 << 4)
 };
 
+/* input queue records are MU_INPUT_WORDS ints: type, then
+**   MOUSEMOVE, SCROLL    x, y
+**   MOUSEDOWN, MOUSEUP   x, y, button
+**   KEYDOWN, KEYUP       key
+**   TEXT                 byte count (1-8), then the utf-8 bytes */
+enum {
+  MU_INPUT_MOUSEMOVE = 1,
+  MU_INPUT_MOUSEDOWN,
+  MU_INPUT_MOUSEUP,
+  MU_INPUT_SCROLL,
+  MU_INPUT_KEYDOWN,
+  MU_INPUT_KEYUP,
+  MU_INPUT_TEXT
+};
+
+#define MU_INPUT_WORDS 4
+
 
 typedef struct mu_Context mu_Context;
 typedef unsigned mu_Id;
@@ -114,15 +136,69 @@ typedef void* mu_Font;
 typedef struct { int x, y; } mu_Vec2;
 typedef struct { int x, y, w, h; } mu_Rect;
 typedef struct { unsigned char r, g, b, a; } mu_Color;
-typedef struct { mu_Id id; int last_update; } mu_PoolItem;
+typedef struct { mu_Id id; int last_update; int prev, next; } mu_PoolItem;
+
+/* a label whose length and id hash are computed once by mu_hashed_label(),
+** for the `_hashed` widgets. `width` caches the text width in `font` as
+** measured under a context's `text_epoch`, it is measured again whenever
+** either differs; `str` must outlive it */
+typedef struct {
+  const char *str;
+  int len;
+  mu_Id hash;
+  mu_Font font;
+  unsigned text_epoch;
+  int width;
+} mu_HashedLabel;
+
+/* retained state pool: a hash index from id to item, plus a list of the items
+** ordered by `last_update` so `mu_pool_init` can evict the oldest one.
+** unlike upstream microui's scans, items last updated in the same frame are
+** evicted in the order they were updated rather than lowest index first, and
+** removed items are reused first, most recently removed first.
+** `mu_pool_get` with id 0 returns -1 instead of an unused item */
+typedef struct {
+  mu_PoolItem *items;
+  int len;
+  int *slots;       /* open addressing, item index + 1, 0 is empty */
+  int slot_mask;
+  int oldest, newest;
+} mu_Pool;
+
+/* ring of input records; the producer only writes records and `head`, so it
+** can fill the queue straight through memory (e.g. a JS typed array) */
+typedef struct {
+  int head, tail;  /* record indices, the queue is empty when equal */
+  int mask;        /* records - 1, the size is a power of two */
+  int dropped;     /* records the producer found no room for */
+  int *records;
+} mu_InputQueue;
+
+/* per-context sizes given to `mu_init_ex`, fields left at 0 use the MU_*_SIZE
+** defaults */
+typedef struct {
+  int command_bytes;   /* size of the first command list chunk */
+  int command_limit;   /* hard cap on command list bytes, -1 for none */
+  int root_list;
+  int container_stack;
+  int clip_stack;
+  int id_stack;
+  int layout_stack;
+  int container_pool;
+  int treenode_pool;
+  int input_queue;     /* records, rounded up to a power of two */
+} mu_Capacity;
 
 typedef struct { int type, size; } mu_BaseCommand;
 typedef struct { mu_BaseCommand base; void *dst; } mu_JumpCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; } mu_ClipCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; mu_Color color; } mu_RectCommand;
-typedef struct { mu_BaseCommand base; mu_Font font; mu_Vec2 pos; mu_Color color; char str[1]; } mu_TextCommand;
+typedef struct { mu_BaseCommand base; mu_Font font; mu_Vec2 pos, size; mu_Color color; char str[1]; } mu_TextCommand;
 typedef struct { mu_BaseCommand base; mu_Rect rect; int id; mu_Color color; } mu_IconCommand;
 
+typedef struct mu_CommandChunk mu_CommandChunk;
+struct mu_CommandChunk { mu_CommandChunk *next; int size; }; /* followed by `size` bytes */
+
 typedef union {
   int type;
   mu_BaseCommand base;
@@ -157,6 +233,36 @@ typedef struct {
   int open;
 } mu_Container;
 
+typedef struct { int first, last, count, pitch, start; } mu_VirtualList;
+
+/* a root container with its zindex next to it, so sorting the roots doesn't
+** chase pointers */
+typedef struct { int zindex; mu_Container *cnt; } mu_RootKey;
+
+/* what a root container drew last frame, kept to work out damaged rects */
+typedef struct { mu_Id hash; mu_Rect rect; } mu_DamageCmd;
+typedef struct {
+  mu_Container *cnt;
+  mu_Id hash;
+  mu_Rect rect;      /* bounds of everything drawn */
+  int first, count;  /* its commands in `cmds` */
+} mu_DamageRoot;
+
+/* word wrap of a `mu_text` string, reused while the string, font and width
+** stay the same */
+typedef struct { int start, len, width; } mu_TextLine;
+typedef struct {
+  mu_Id hash;        /* of the `len` bytes of text wrapped */
+  char *text;        /* a copy of them, malloc'd, grown as needed */
+  int text_capacity;
+  mu_Font font;
+  unsigned text_epoch; /* the context's when the text was measured */
+  int width, len;
+  int last_update;
+  mu_TextLine *lines; /* malloc'd, grown as needed */
+  int line_count, line_capacity;
+} mu_TextLayout;
+
 typedef struct {
   mu_Font font;
   mu_Vec2 size;
@@ -184,22 +290,53 @@ struct mu_Context {
   int last_zindex;
   int updated_focus;
   int frame;
+  /* changes with the way text is measured, see mu_text_metrics_changed() */
+  unsigned text_epoch;
+  mu_Id frame_hash;   /* of the commands drawn, set by `mu_end` */
+  int frame_changed;  /* commands differ from the previous frame */
+  mu_Id state_hash;   /* of the retained state the next frame depends on */
+  int state_changed;
+  /* damaged rects, set by `mu_end`; repainting them turns the previous
+  ** frame (`base` is its `frame_hash`) into this one */
+  struct {
+    mu_Rect rects[MU_DAMAGE_MAX];
+    int count;
+    mu_Id base;
+    mu_DamageRoot *roots, *prev_roots; /* root_list.size each, in `block` */
+    int root_count, prev_root_count;
+    mu_DamageCmd *cmds, *prev_cmds;    /* malloc'd, grown as needed */
+    int cmd_count, prev_cmd_count;
+    int cmd_capacity, prev_cmd_capacity;
+  } damage;
   mu_Container *hover_root;
   mu_Container *next_hover_root;
   mu_Container *scroll_target;
   char number_edit_buf[MU_MAX_FMT];
   mu_Id number_edit;
-  /* stacks */
-  mu_stack(char, MU_COMMANDLIST_SIZE) command_list;
-  mu_stack(mu_Container*, MU_ROOTLIST_SIZE) root_list;
-  mu_stack(mu_Container*, MU_CONTAINERSTACK_SIZE) container_stack;
-  mu_stack(mu_Rect, MU_CLIPSTACK_SIZE) clip_stack;
-  mu_stack(mu_Id, MU_IDSTACK_SIZE) id_stack;
-  mu_stack(mu_Layout, MU_LAYOUTSTACK_SIZE) layout_stack;
+  /* command list: chained chunks, kept across frames */
+  struct {
+    mu_CommandChunk *head, *chunk;
+    mu_CommandChunk *first; /* lives in `block`, not freed on its own */
+    char *ptr, *end;
+    int idx;      /* bytes used this frame */
+    int capacity; /* bytes allocated in all chunks */
+    int limit;    /* hard cap on `idx`, 0 for none */
+    int overflow; /* commands dropped this frame because of `limit` */
+  } command_list;
+  /* stacks and pools, carved from `block` */
+  void *block;
+  int block_size;
+  mu_stack(mu_Container*) root_list;
+  mu_RootKey *root_keys; /* 2 * root_list.size, scratch of `mu_end` */
+  mu_stack(mu_Container*) container_stack;
+  mu_stack(mu_Rect) clip_stack;
+  mu_stack(mu_Id) id_stack;
+  mu_stack(mu_Layout) layout_stack;
   /* retained state pools */
-  mu_PoolItem container_pool[MU_CONTAINERPOOL_SIZE];
-  mu_Container containers[MU_CONTAINERPOOL_SIZE];
-  mu_PoolItem treenode_pool[MU_TREENODEPOOL_SIZE];
+  mu_Pool container_pool;
+  mu_Container *containers;
+  mu_Pool treenode_pool;
+  mu_TextLayout text_layouts[MU_TEXTLAYOUT_SIZE];
   /* input state */
   mu_Vec2 mouse_pos;
   mu_Vec2 last_mouse_pos;
@@ -209,7 +346,14 @@ struct mu_Context {
   int mouse_pressed;
   int key_down;
   int key_pressed;
-  char input_text[32];
+  /* utf-8 text typed or pasted this frame, nul terminated; `pos` is how
+  ** much a textbox took so far */
+  struct {
+    char *items; /* malloc'd on first use */
+    int len, pos, size;
+  } input_text;
+  int input_dirty;    /* input arrived since the last `mu_begin` */
+  mu_InputQueue input_queue;
 };
 
 
@@ -218,11 +362,19 @@ mu_Rect mu_rect(int x, int y, int w, int h);
 mu_Color mu_color(int r, int g, int b, int a);
 
 void mu_init(mu_Context *ctx);
+void mu_init_ex(mu_Context *ctx, const mu_Capacity *cap);
+void mu_deinit(mu_Context *ctx);
+void mu_text_metrics_changed(mu_Context *ctx);
 void mu_begin(mu_Context *ctx);
 void mu_end(mu_Context *ctx);
+int mu_needs_frame(mu_Context *ctx);
 void mu_set_focus(mu_Context *ctx, mu_Id id);
 mu_Id mu_get_id(mu_Context *ctx, const void *data, int size);
+mu_Id mu_hash_id(const void *data, int size);
+mu_Id mu_get_id_hashed(mu_Context *ctx, mu_Id label_hash);
 void mu_push_id(mu_Context *ctx, const void *data, int size);
+void mu_push_id_hashed(mu_Context *ctx, mu_Id label_hash);
+mu_HashedLabel mu_hashed_label(const char *str, int len);
 void mu_pop_id(mu_Context *ctx);
 void mu_push_clip_rect(mu_Context *ctx, mu_Rect rect);
 void mu_pop_clip_rect(mu_Context *ctx);
@@ -232,9 +384,12 @@ mu_Container* mu_get_current_container(mu_Context *ctx);
 mu_Container* mu_get_container(mu_Context *ctx, const char *name);
 void mu_bring_to_front(mu_Context *ctx, mu_Container *cnt);
 
-int mu_pool_init(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id);
-int mu_pool_get(mu_Context *ctx, mu_PoolItem *items, int len, mu_Id id);
-void mu_pool_update(mu_Context *ctx, mu_PoolItem *items, int idx);
+int mu_pool_slot_count(int len);
+void mu_pool_setup(mu_Pool *pool, mu_PoolItem *items, int len, int *slots);
+int mu_pool_init(mu_Context *ctx, mu_Pool *pool, mu_Id id);
+int mu_pool_get(mu_Context *ctx, mu_Pool *pool, mu_Id id);
+void mu_pool_update(mu_Context *ctx, mu_Pool *pool, int idx);
+void mu_pool_remove(mu_Context *ctx, mu_Pool *pool, int idx);
 
 void mu_input_mousemove(mu_Context *ctx, int x, int y);
 void mu_input_mousedown(mu_Context *ctx, int x, int y, int btn);
@@ -243,6 +398,11 @@ void mu_input_scroll(mu_Context *ctx, int x, int y);
 void mu_input_keydown(mu_Context *ctx, int key);
 void mu_input_keyup(mu_Context *ctx, int key);
 void mu_input_text(mu_Context *ctx, const char *text);
+char* mu_input_text_reserve(mu_Context *ctx, int n);
+void mu_input_text_commit(mu_Context *ctx, int n);
+int mu_queue_input(mu_Context *ctx, int type, int a, int b, int c);
+int mu_queue_text(mu_Context *ctx, const char *text);
+int mu_drain_input(mu_Context *ctx);
 
 mu_Command* mu_push_command(mu_Context *ctx, int type, int size);
 int mu_next_command(mu_Context *ctx, mu_Command **cmd);
@@ -292,5 +452,19 @@ int mu_begin_popup(mu_Context *ctx, const char *name);
 void mu_end_popup(mu_Context *ctx);
 void mu_begin_panel_ex(mu_Context *ctx, const char *name, int opt);
 void mu_end_panel(mu_Context *ctx);
+void mu_begin_virtual_list(mu_Context *ctx, mu_VirtualList *list, int count, int row_height);
+void mu_end_virtual_list(mu_Context *ctx, mu_VirtualList *list);
+
+/* the same widgets taking a label from mu_hashed_label(), they give the same
+** ids as their string counterparts */
+void mu_label_hashed(mu_Context *ctx, mu_HashedLabel *label);
+int mu_button_hashed(mu_Context *ctx, mu_HashedLabel *label, int icon, int opt);
+int mu_checkbox_hashed(mu_Context *ctx, mu_HashedLabel *label, int *state);
+int mu_header_hashed(mu_Context *ctx, mu_HashedLabel *label, int opt);
+int mu_begin_treenode_hashed(mu_Context *ctx, mu_HashedLabel *label, int opt);
+int mu_begin_window_hashed(mu_Context *ctx, mu_HashedLabel *title, mu_Rect rect, int opt);
+void mu_open_popup_hashed(mu_Context *ctx, mu_HashedLabel *name);
+int mu_begin_popup_hashed(mu_Context *ctx, mu_HashedLabel *name);
+void mu_begin_panel_hashed(mu_Context *ctx, mu_HashedLabel *name, int opt);
 
 #endif
@@ -0,0 +1,353 @@
+#include "packed_commands.h"
+
+#include <algorithm>
+#include <cstring>
+
+int32_t pack_color(mu_Color color) {
+    int32_t res;
+    static_assert(sizeof(res) == sizeof(color), "mu_Color should be 4 bytes");
+    memcpy(&res, &color, sizeof(res));
+    return res;
+}
+
+/*============================================================================
+** text table
+**============================================================================*/
+
+// strings that were not drawn for this many frames may be dropped
+static const int STALE_FRAMES = 120;
+// don't bother compacting tables smaller than this
+static const int COMPACT_MIN_BYTES = 64 * 1024;
+
+static uint32_t hash_bytes(const char *str, int len) {
+    // 32bit fnv-1a hash
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < len; ++i)
+        h = (h ^ (unsigned char)str[i]) * 16777619u;
+    return h;
+}
+
+int TextTable::lookup(uint32_t hash, const char *str, int len) const {
+    if (slots.empty())
+        return -1;
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+        int idx = slots[i] - 1;
+        if (idx < 0)
+            return -1;
+        const Entry &e = entries[idx];
+        if (e.hash == hash && e.len == len && memcmp(bytes.data() + e.offset, str, len) == 0)
+            return idx;
+    }
+}
+
+void TextTable::rehash(size_t nslots) {
+    slots.assign(nslots, 0);
+    size_t mask = nslots - 1;
+    for (size_t idx = 0; idx < entries.size(); ++idx) {
+        size_t i = entries[idx].hash & mask;
+        while (slots[i])
+            i = (i + 1) & mask;
+        slots[i] = idx + 1;
+    }
+}
+
+const TextTable::Entry &TextTable::intern(const char *str, int len) {
+    uint32_t hash = hash_bytes(str, len);
+    int idx = lookup(hash, str, len);
+    if (idx < 0) {
+        // keep the load factor below 1/2
+        if ((entries.size() + 1) * 2 > slots.size())
+            rehash(slots.empty() ? 64 : slots.size() * 2);
+        Entry e;
+        e.hash = hash;
+        e.id = next_id++;
+        e.offset = bytes.size();
+        e.len = len;
+        e.last_frame = frame;
+        bytes.insert(bytes.end(), str, str + len);
+        entries.push_back(e);
+        idx = entries.size() - 1;
+        size_t mask = slots.size() - 1;
+        size_t i = hash & mask;
+        while (slots[i])
+            i = (i + 1) & mask;
+        slots[i] = idx + 1;
+    }
+    entries[idx].last_frame = frame;
+    return entries[idx];
+}
+
+void TextTable::next_frame() {
+    ++frame;
+    if ((int)bytes.size() < COMPACT_MIN_BYTES)
+        return;
+    int stale = 0;
+    for (const Entry &e : entries)
+        if (frame - e.last_frame > STALE_FRAMES)
+            stale += e.len;
+    // only compact when at least half of the storage is garbage
+    if (stale * 2 < (int)bytes.size())
+        return;
+    compact();
+}
+
+void TextTable::compact() {
+    std::vector<char> live_bytes;
+    size_t n = 0;
+    for (const Entry &e : entries) {
+        if (frame - e.last_frame > STALE_FRAMES)
+            continue;
+        Entry moved = e;
+        moved.offset = live_bytes.size();
+        live_bytes.insert(live_bytes.end(), bytes.begin() + e.offset, bytes.begin() + e.offset + e.len);
+        entries[n++] = moved;
+    }
+    entries.resize(n);
+    bytes.swap(live_bytes);
+    size_t nslots = 64;
+    while (nslots < entries.size() * 2)
+        nslots *= 2;
+    rehash(nslots);
+    ++gen;
+}
+
+/*============================================================================
+** packer
+**============================================================================*/
+
+static void push_record(std::vector<int32_t> &words, int type, mu_Rect r, int32_t color, int32_t arg0,
+                        int32_t arg1) {
+    size_t base = words.size();
+    words.resize(base + PACKED_WORDS);
+    int32_t *rec = &words[base];
+    rec[PACKED_TYPE] = type;
+    rec[PACKED_X] = r.x;
+    rec[PACKED_Y] = r.y;
+    rec[PACKED_W] = r.w;
+    rec[PACKED_H] = r.h;
+    rec[PACKED_COLOR] = color;
+    rec[PACKED_ARG0] = arg0;
+    rec[PACKED_ARG1] = arg1;
+}
+
+int CommandPacker::pack(mu_Context *ctx) {
+    words.clear();
+    strings.next_frame();
+
+    mu_Command *cmd = NULL;
+    while (mu_next_command(ctx, &cmd)) {
+        switch (cmd->type) {
+        case MU_COMMAND_CLIP:
+            push_record(words, MU_COMMAND_CLIP, cmd->clip.rect, 0, 0, 0);
+            break;
+        case MU_COMMAND_RECT:
+            push_record(words, MU_COMMAND_RECT, cmd->rect.rect, pack_color(cmd->rect.color), 0, 0);
+            break;
+        case MU_COMMAND_ICON:
+            push_record(words, MU_COMMAND_ICON, cmd->icon.rect, pack_color(cmd->icon.color), cmd->icon.id, 0);
+            break;
+        case MU_COMMAND_TEXT: {
+            const TextTable::Entry &e = strings.intern(cmd->text.str, strlen(cmd->text.str));
+            mu_Rect r = mu_rect(cmd->text.pos.x, cmd->text.pos.y, e.offset, e.len);
+            push_record(words, MU_COMMAND_TEXT, r, pack_color(cmd->text.color), e.id, cmd->text.size.x);
+            break;
+        }
+        }
+    }
+    return count();
+}
+
+
+/*============================================================================
+** optimizer
+**============================================================================*/
+
+// at most this many opaque rects are remembered as occluders, the largest win
+static const int MAX_OCCLUDERS = 8;
+// thinner rects (borders, mostly) hardly ever cover anything
+static const int MIN_OCCLUDER_SIZE = 8;
+// glyphs may paint this far outside the measured text box, as in the
+// `TEXT_MARGIN` of src/replay.mjs and microui.c
+static const int TEXT_MARGIN = 2;
+
+static mu_Rect intersect(mu_Rect a, mu_Rect b) {
+    int x1 = std::max(a.x, b.x);
+    int y1 = std::max(a.y, b.y);
+    int x2 = std::min(a.x + a.w, b.x + b.w);
+    int y2 = std::min(a.y + a.h, b.y + b.h);
+    return mu_rect(x1, y1, std::max(x2 - x1, 0), std::max(y2 - y1, 0));
+}
+
+static bool contains(mu_Rect outer, mu_Rect inner) {
+    return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.w <= outer.x + outer.w &&
+           inner.y + inner.h <= outer.y + outer.h;
+}
+
+static bool is_empty(mu_Rect r) {
+    return r.w <= 0 || r.h <= 0;
+}
+
+static mu_Rect record_rect(const int32_t *rec) {
+    return mu_rect(rec[PACKED_X], rec[PACKED_Y], rec[PACKED_W], rec[PACKED_H]);
+}
+
+static bool is_opaque(int32_t color) {
+    mu_Color c;
+    memcpy(&c, &color, sizeof(c));
+    return c.a == 255;
+}
+
+// the union of `a` and `b` if it is a rect that paints the same pixels as
+// drawing `a`, then `b`, in `color`
+static bool merge_rects(mu_Rect a, mu_Rect b, int32_t color, mu_Rect *res) {
+    bool opaque = is_opaque(color);
+    if (opaque && contains(a, b)) {
+        *res = a;
+        return true;
+    }
+    int lo, hi;
+    if (a.y == b.y && a.h == b.h) {
+        lo = std::max(a.x, b.x);
+        hi = std::min(a.x + a.w, b.x + b.w);
+        // blending the overlap twice would darken it
+        if (lo > hi || (lo < hi && !opaque))
+            return false;
+        int x = std::min(a.x, b.x);
+        *res = mu_rect(x, a.y, std::max(a.x + a.w, b.x + b.w) - x, a.h);
+        return true;
+    }
+    if (a.x == b.x && a.w == b.w) {
+        lo = std::max(a.y, b.y);
+        hi = std::min(a.y + a.h, b.y + b.h);
+        if (lo > hi || (lo < hi && !opaque))
+            return false;
+        int y = std::min(a.y, b.y);
+        *res = mu_rect(a.x, y, a.w, std::max(a.y + a.h, b.y + b.h) - y);
+        return true;
+    }
+    return false;
+}
+
+int CommandPacker::optimize(mu_Context *ctx) {
+    // `clips` entries besides the index of a CLIP record
+    enum { NO_CLIP = -1, SKIP = -2 };
+
+    int n = count();
+    stats = {};
+    stats.records_before = n;
+    int text_height = ctx->text_height(ctx->style->font);
+
+    // what each record may paint and the CLIP record it is drawn under
+    bounds.resize(n);
+    clips.resize(n);
+    int clip = NO_CLIP;
+    for (int i = 0; i < n; ++i) {
+        const int32_t *rec = &words[i * PACKED_WORDS];
+        if (rec[PACKED_TYPE] == MU_COMMAND_CLIP) {
+            clip = i;
+            clips[i] = SKIP;
+            continue;
+        }
+        mu_Rect r = record_rect(rec);
+        if (rec[PACKED_TYPE] == MU_COMMAND_TEXT)
+            r = mu_rect(r.x - TEXT_MARGIN, r.y - TEXT_MARGIN, rec[PACKED_TEXT_WIDTH] + 2 * TEXT_MARGIN,
+                        text_height + 2 * TEXT_MARGIN);
+        bounds[i] = r;
+        clips[i] = clip;
+    }
+
+    // back to front: cull what is clipped away or covered by the opaque rects
+    // drawn later
+    mu_Rect occluders[MAX_OCCLUDERS];
+    int64_t areas[MAX_OCCLUDERS];
+    int occluder_count = 0;
+    int smallest = 0;
+    for (int i = n - 1; i >= 0; --i) {
+        if (clips[i] == SKIP)
+            continue;
+        const int32_t *rec = &words[i * PACKED_WORDS];
+        mu_Rect visible = bounds[i];
+        if (clips[i] != NO_CLIP)
+            visible = intersect(visible, record_rect(&words[clips[i] * PACKED_WORDS]));
+        mu_Color color;
+        memcpy(&color, &rec[PACKED_COLOR], sizeof(color));
+        bool hidden = is_empty(visible) || color.a == 0;
+        for (int j = 0; j < occluder_count && !hidden; ++j)
+            hidden = contains(occluders[j], visible);
+        if (hidden) {
+            clips[i] = SKIP;
+            ++stats.culled;
+            continue;
+        }
+        if (rec[PACKED_TYPE] != MU_COMMAND_RECT || color.a != 255 || visible.w < MIN_OCCLUDER_SIZE ||
+            visible.h < MIN_OCCLUDER_SIZE)
+            continue;
+        int64_t area = (int64_t)visible.w * visible.h;
+        if (occluder_count == MAX_OCCLUDERS && area <= areas[smallest])
+            continue;
+        int slot = occluder_count < MAX_OCCLUDERS ? occluder_count++ : smallest;
+        occluders[slot] = visible;
+        areas[slot] = area;
+        for (int j = 0; j < occluder_count; ++j) {
+            if (areas[j] < areas[smallest])
+                smallest = j;
+        }
+    }
+
+    // front to back: a record drawn under clip `c` while `current` is in
+    // effect paints the same pixels if it lies inside both, so the clip only
+    // changes for records that cross it
+    // each input CLIP is written at most once, so this never outgrows the input
+    optimized.resize(words.size());
+    int out = 0;
+    int current = NO_CLIP;
+    // the offset of the last RECT written, while nothing was written after it
+    int last_rect = -1;
+    for (int i = 0; i < n; ++i) {
+        int c = clips[i];
+        if (c == SKIP)
+            continue;
+        const int32_t *rec = &words[i * PACKED_WORDS];
+        mu_Rect r = bounds[i];
+        if (c != current) {
+            bool inside_current = current == NO_CLIP || contains(record_rect(&words[current * PACKED_WORDS]), r);
+            bool inside_clip = c == NO_CLIP || contains(record_rect(&words[c * PACKED_WORDS]), r);
+            if (!inside_current || !inside_clip) {
+                // records before the first CLIP are the only unclipped ones
+                if (c != NO_CLIP) {
+                    memcpy(&optimized[out], &words[c * PACKED_WORDS], PACKED_WORDS * sizeof(int32_t));
+                    out += PACKED_WORDS;
+                }
+                current = c;
+                last_rect = -1;
+            }
+        }
+        if (rec[PACKED_TYPE] == MU_COMMAND_RECT && last_rect >= 0 &&
+            optimized[last_rect + PACKED_COLOR] == rec[PACKED_COLOR]) {
+            mu_Rect merged;
+            if (merge_rects(record_rect(&optimized[last_rect]), r, rec[PACKED_COLOR], &merged)) {
+                optimized[last_rect + PACKED_X] = merged.x;
+                optimized[last_rect + PACKED_Y] = merged.y;
+                optimized[last_rect + PACKED_W] = merged.w;
+                optimized[last_rect + PACKED_H] = merged.h;
+                ++stats.merged;
+                continue;
+            }
+        }
+        last_rect = rec[PACKED_TYPE] == MU_COMMAND_RECT ? out : -1;
+        memcpy(&optimized[out], rec, PACKED_WORDS * sizeof(int32_t));
+        out += PACKED_WORDS;
+    }
+    optimized.resize(out);
+
+    int clips_before = 0, clips_after = 0;
+    for (int i = 0; i < n; ++i)
+        clips_before += words[i * PACKED_WORDS + PACKED_TYPE] == MU_COMMAND_CLIP;
+    words.swap(optimized);
+    stats.records_after = count();
+    for (int i = 0; i < stats.records_after; ++i)
+        clips_after += words[i * PACKED_WORDS + PACKED_TYPE] == MU_COMMAND_CLIP;
+    stats.clips_dropped = clips_before - clips_after;
+    return stats.records_after;
+}
@@ -0,0 +1,126 @@
+#ifndef PACKED_COMMANDS_H
+#define PACKED_COMMANDS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "microui.h"
+}
+
+// Every command of the jump-resolved command list is flattened into a record
+// of `PACKED_WORDS` int32 words, so a renderer can walk the whole frame with
+// one `Int32Array` view instead of one embind object per command.
+//
+//   type  | x     | y     | w           | h          | color | arg0      | arg1
+//   ------+-------+-------+-------------+------------+-------+-----------+-----
+//   CLIP  | rect.x, rect.y, rect.w, rect.h           | 0     | 0         | 0
+//   RECT  | rect.x, rect.y, rect.w, rect.h           | rgba  | 0         | 0
+//   ICON  | rect.x, rect.y, rect.w, rect.h           | rgba  | icon id   | 0
+//   TEXT  | pos.x | pos.y | text offset | text bytes | rgba  | string id | width
+//
+// `color` keeps the `mu_Color` byte order, so it can also be read as four
+// bytes through an `Uint8Array`. Text offsets are relative to `text()`.
+enum {
+    PACKED_TYPE,
+    PACKED_X,
+    PACKED_Y,
+    PACKED_W,
+    PACKED_H,
+    PACKED_COLOR,
+    PACKED_ARG0,
+    PACKED_ARG1,
+    PACKED_WORDS,
+
+    PACKED_TEXT_OFFSET = PACKED_W,
+    PACKED_TEXT_LEN = PACKED_H,
+    PACKED_TEXT_ID = PACKED_ARG0,
+    PACKED_TEXT_WIDTH = PACKED_ARG1
+};
+
+// Interns the strings of TEXT commands. Equal strings get the same id for as
+// long as they keep being drawn, so a renderer only has to decode (and
+// measure) a string the first time its id shows up. Ids are never reused;
+// strings that were not drawn for a while are dropped when the byte storage
+// is compacted, which bumps `generation()` so caches keyed by id can be
+// flushed.
+class TextTable {
+  public:
+    struct Entry {
+        uint32_t hash;
+        int id;
+        int offset;
+        int len;
+        int last_frame;
+    };
+
+    // the returned entry stays valid until the next `intern` call
+    const Entry &intern(const char *str, int len);
+    // may compact the byte storage, so call it between frames
+    void next_frame();
+
+    const char *data() const { return bytes.data(); }
+    int generation() const { return gen; }
+
+  private:
+    int lookup(uint32_t hash, const char *str, int len) const;
+    void rehash(size_t nslots);
+    void compact();
+
+    std::vector<Entry> entries;
+    // open addressing, holds indices into `entries` plus one, 0 is empty
+    std::vector<int> slots;
+    std::vector<char> bytes;
+    int next_id = 1;
+    int frame = 0;
+    int gen = 0;
+    int stale_bytes = 0;
+};
+
+// What `CommandPacker::optimize` did to the last frame.
+struct OptimizeStats {
+    int records_before;
+    int records_after;
+    // CLIP records no drawn record needed
+    int clips_dropped;
+    // records that were clipped away or covered by a later opaque RECT
+    int culled;
+    // RECTs folded into the one drawn before them
+    int merged;
+};
+
+class CommandPacker {
+  public:
+    // returns the number of packed records
+    int pack(mu_Context *ctx);
+    // Rewrites the records of the last `pack` into a shorter list that paints
+    // the same pixels, for renderers that pay per call: CLIP records are only
+    // kept where a record actually crosses the clip rect, records that are
+    // clipped away or covered by a later opaque RECT are dropped, and RECTs of
+    // the same colour drawn one after another merge when their union is a
+    // rect. `ctx` gives the height of TEXT records. Returns the number of
+    // records.
+    int optimize(mu_Context *ctx);
+    const OptimizeStats &optimize_stats() const { return stats; }
+
+    const int32_t *data() const { return words.data(); }
+    const char *text() const { return strings.data(); }
+    int text_generation() const { return strings.generation(); }
+    int count() const { return (int)(words.size() / PACKED_WORDS); }
+
+  private:
+    // keeps its capacity across frames
+    std::vector<int32_t> words;
+    TextTable strings;
+
+    OptimizeStats stats = {};
+    // scratch space of `optimize`
+    std::vector<int32_t> optimized;
+    std::vector<mu_Rect> bounds;
+    std::vector<int> clips;
+};
+
+int32_t pack_color(mu_Color color);
+
+#endif
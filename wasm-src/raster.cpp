@@ -0,0 +1,392 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static mu_Rect intersect(mu_Rect a, mu_Rect b) {
+    int x1 = std::max(a.x, b.x);
+    int y1 = std::max(a.y, b.y);
+    int x2 = std::min(a.x + a.w, b.x + b.w);
+    int y2 = std::min(a.y + a.h, b.y + b.h);
+    return mu_rect(x1, y1, std::max(x2 - x1, 0), std::max(y2 - y1, 0));
+}
+
+// same as in text_width_cache.cpp, so glyphs are looked up by the codepoints
+// that were measured
+static int decode_utf8(const unsigned char *p, const unsigned char *end, unsigned *cp) {
+    unsigned c = p[0];
+    int n = c < 0x80 ? 1 : (c & 0xe0) == 0xc0 ? 2 : (c & 0xf0) == 0xe0 ? 3 : (c & 0xf8) == 0xf0 ? 4 : 0;
+    if (n == 0 || p + n > end) {
+        *cp = c;
+        return 1;
+    }
+    unsigned res = n == 1 ? c : c & (0x3f >> (n - 1));
+    for (int i = 1; i < n; ++i) {
+        if ((p[i] & 0xc0) != 0x80) {
+            *cp = c;
+            return 1;
+        }
+        res = (res << 6) | (p[i] & 0x3f);
+    }
+    *cp = res;
+    return n;
+}
+
+/*============================================================================
+** spans
+**============================================================================*/
+
+// `color` as a framebuffer word, with an opaque alpha byte so that blending
+// it does source-over on the framebuffer's alpha too
+static uint32_t opaque_word(mu_Color color) {
+    color.a = 255;
+    uint32_t res;
+    memcpy(&res, &color, sizeof(res));
+    return res;
+}
+
+// `dst + (src - dst) * a / 255` on the four bytes, two at a time in the even
+// and odd byte lanes
+static inline uint32_t blend(uint32_t dst, uint32_t src, unsigned a) {
+    unsigned na = 255 - a;
+    uint32_t rb = (src & 0xff00ff) * a + (dst & 0xff00ff) * na + 0x800080;
+    uint32_t ag = ((src >> 8) & 0xff00ff) * a + ((dst >> 8) & 0xff00ff) * na + 0x800080;
+    rb = ((rb + ((rb >> 8) & 0xff00ff)) >> 8) & 0xff00ff;
+    ag = (ag + ((ag >> 8) & 0xff00ff)) & 0xff00ff00;
+    return rb | ag;
+}
+
+static inline unsigned mul255(unsigned a, unsigned b) {
+    unsigned x = a * b + 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#if defined(RASTER_SCALAR)
+#define RASTER_SIMD 0
+#elif defined(__wasm_simd128__)
+#define RASTER_SIMD 1
+#include <wasm_simd128.h>
+
+typedef v128_t vec;
+
+static inline vec load(const void *p) { return wasm_v128_load(p); }
+static inline void store(void *p, vec v) { wasm_v128_store(p, v); }
+static inline vec splat32(uint32_t x) { return wasm_i32x4_splat(x); }
+static inline vec splat16(unsigned x) { return wasm_i16x8_splat(x); }
+// the 4 bytes at `p` as the low 16-bit lanes
+static inline vec load4_u16(const uint8_t *p) { return wasm_u16x8_extend_low_u8x16(wasm_v128_load32_zero(p)); }
+static inline vec widen_lo(vec v) { return wasm_u16x8_extend_low_u8x16(v); }
+static inline vec widen_hi(vec v) { return wasm_u16x8_extend_high_u8x16(v); }
+static inline vec narrow(vec lo, vec hi) { return wasm_u8x16_narrow_i16x8(lo, hi); }
+static inline vec add16(vec a, vec b) { return wasm_i16x8_add(a, b); }
+static inline vec sub16(vec a, vec b) { return wasm_i16x8_sub(a, b); }
+static inline vec mul16(vec a, vec b) { return wasm_i16x8_mul(a, b); }
+static inline vec shr8_16(vec v) { return wasm_u16x8_shr(v, 8); }
+// lanes 0, 1 (or 2, 3) of `v`, each repeated for the 4 channels of a pixel
+static inline vec spread_lo(vec v) { return wasm_i16x8_shuffle(v, v, 0, 0, 0, 0, 1, 1, 1, 1); }
+static inline vec spread_hi(vec v) { return wasm_i16x8_shuffle(v, v, 2, 2, 2, 2, 3, 3, 3, 3); }
+#elif defined(__SSE2__)
+#define RASTER_SIMD 1
+#include <emmintrin.h>
+
+typedef __m128i vec;
+
+static inline vec load(const void *p) { return _mm_loadu_si128((const __m128i *)p); }
+static inline void store(void *p, vec v) { _mm_storeu_si128((__m128i *)p, v); }
+static inline vec splat32(uint32_t x) { return _mm_set1_epi32((int)x); }
+static inline vec splat16(unsigned x) { return _mm_set1_epi16((short)x); }
+static inline vec load4_u16(const uint8_t *p) {
+    int32_t x;
+    memcpy(&x, p, sizeof(x));
+    return _mm_unpacklo_epi8(_mm_cvtsi32_si128(x), _mm_setzero_si128());
+}
+static inline vec widen_lo(vec v) { return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+static inline vec widen_hi(vec v) { return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+static inline vec narrow(vec lo, vec hi) { return _mm_packus_epi16(lo, hi); }
+static inline vec add16(vec a, vec b) { return _mm_add_epi16(a, b); }
+static inline vec sub16(vec a, vec b) { return _mm_sub_epi16(a, b); }
+static inline vec mul16(vec a, vec b) { return _mm_mullo_epi16(a, b); }
+static inline vec shr8_16(vec v) { return _mm_srli_epi16(v, 8); }
+static inline vec spread_lo(vec v) {
+    v = _mm_unpacklo_epi16(v, v);
+    return _mm_unpacklo_epi32(v, v);
+}
+static inline vec spread_hi(vec v) {
+    v = _mm_unpacklo_epi16(v, v);
+    return _mm_unpackhi_epi32(v, v);
+}
+#else
+#define RASTER_SIMD 0
+#endif
+
+#if RASTER_SIMD
+// `(x + 128) / 255` rounded like `mul255`, on 16-bit lanes that already hold
+// the + 128
+static inline vec div255(vec x) {
+    return shr8_16(add16(x, shr8_16(x)));
+}
+
+// `blend` of two pixels widened to 16-bit lanes, with `sa` holding
+// `src * a + 128` and `na` holding `255 - a` per lane
+static inline vec blend16(vec dst, vec sa, vec na) {
+    return div255(add16(mul16(dst, na), sa));
+}
+#endif
+
+static void fill_span(uint32_t *dst, int n, uint32_t src) {
+    int i = 0;
+#if RASTER_SIMD
+    vec v = splat32(src);
+    for (; i + 16 <= n; i += 16) {
+        store(dst + i, v);
+        store(dst + i + 4, v);
+        store(dst + i + 8, v);
+        store(dst + i + 12, v);
+    }
+    for (; i + 4 <= n; i += 4)
+        store(dst + i, v);
+#endif
+    for (; i < n; ++i)
+        dst[i] = src;
+}
+
+static void blend_span(uint32_t *dst, int n, uint32_t src, unsigned a) {
+    int i = 0;
+#if RASTER_SIMD
+    vec s = widen_lo(splat32(src));
+    vec sa = add16(mul16(s, splat16(a)), splat16(128));
+    vec na = splat16(255 - a);
+    for (; i + 4 <= n; i += 4) {
+        vec d = load(dst + i);
+        store(dst + i, narrow(blend16(widen_lo(d), sa, na), blend16(widen_hi(d), sa, na)));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = blend(dst[i], src, a);
+}
+
+// `mask` scales the alpha `a` per pixel
+static void blend_mask_span(uint32_t *dst, const uint8_t *mask, int n, uint32_t src, unsigned a) {
+    int i = 0;
+#if RASTER_SIMD
+    vec s = widen_lo(splat32(src));
+    vec va = splat16(a);
+    vec half = splat16(128);
+    vec full = splat16(255);
+    for (; i + 4 <= n; i += 4) {
+        uint32_t m;
+        memcpy(&m, mask + i, sizeof(m));
+        // glyph masks are mostly empty
+        if (m == 0)
+            continue;
+        vec alpha = div255(add16(mul16(load4_u16(mask + i), va), half));
+        vec alo = spread_lo(alpha), ahi = spread_hi(alpha);
+        vec d = load(dst + i);
+        vec lo = blend16(widen_lo(d), add16(mul16(s, alo), half), sub16(full, alo));
+        vec hi = blend16(widen_hi(d), add16(mul16(s, ahi), half), sub16(full, ahi));
+        store(dst + i, narrow(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) {
+        if (mask[i] != 0)
+            dst[i] = blend(dst[i], src, mul255(mask[i], a));
+    }
+}
+
+/*============================================================================
+** masks
+**============================================================================*/
+
+struct Segment {
+    float x0, y0, x1, y1;
+};
+
+static float segment_distance(const Segment &s, float x, float y) {
+    float dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+    float t = ((x - s.x0) * dx + (y - s.y0) * dy) / (dx * dx + dy * dy);
+    t = std::min(std::max(t, 0.0f), 1.0f);
+    float px = s.x0 + t * dx - x, py = s.y0 + t * dy - y;
+    return std::sqrt(px * px + py * py);
+}
+
+// coverage of `segments` (in units of the mask size) stroked `width` px wide,
+// from 4x4 samples per pixel
+static void stroke_mask(uint8_t *alpha, int size, const Segment *segments, int count, float width) {
+    const int SAMPLES = 4;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            int hits = 0;
+            for (int sy = 0; sy < SAMPLES; ++sy) {
+                for (int sx = 0; sx < SAMPLES; ++sx) {
+                    float px = x + (sx + 0.5f) / SAMPLES, py = y + (sy + 0.5f) / SAMPLES;
+                    for (int i = 0; i < count; ++i) {
+                        Segment s = {segments[i].x0 * size, segments[i].y0 * size, segments[i].x1 * size,
+                                     segments[i].y1 * size};
+                        if (segment_distance(s, px, py) <= width / 2) {
+                            ++hits;
+                            break;
+                        }
+                    }
+                }
+            }
+            alpha[y * size + x] = hits * 255 / (SAMPLES * SAMPLES);
+        }
+    }
+}
+
+/*============================================================================
+** rasterizer
+**============================================================================*/
+
+Rasterizer::Rasterizer() {
+    clip = mu_rect(0, 0, 0, 0);
+    for (Glyph &g : ascii)
+        g.advance = -1;
+    bake_icons();
+}
+
+void Rasterizer::resize(int width, int height) {
+    fb_width = std::max(width, 0);
+    fb_height = std::max(height, 0);
+    fb.resize((size_t)fb_width * fb_height);
+}
+
+void Rasterizer::clear(mu_Color color) {
+    uint32_t word;
+    memcpy(&word, &color, sizeof(word));
+    fill_span(fb.data(), (int)fb.size(), word);
+}
+
+void Rasterizer::draw(mu_Context *ctx) {
+    draw(ctx, mu_rect(0, 0, fb_width, fb_height));
+}
+
+void Rasterizer::draw(mu_Context *ctx, mu_Rect area) {
+    mu_Rect bounds = intersect(area, mu_rect(0, 0, fb_width, fb_height));
+    clip = bounds;
+    mu_Command *cmd = NULL;
+    while (mu_next_command(ctx, &cmd)) {
+        switch (cmd->type) {
+        case MU_COMMAND_CLIP:
+            clip = intersect(cmd->clip.rect, bounds);
+            break;
+        case MU_COMMAND_RECT:
+            fill_rect(cmd->rect.rect, cmd->rect.color);
+            break;
+        case MU_COMMAND_ICON: {
+            if (cmd->icon.id <= 0 || cmd->icon.id >= MU_ICON_MAX)
+                break;
+            const Mask &mask = icons[cmd->icon.id];
+            mu_Rect r = cmd->icon.rect;
+            draw_mask(mask, r.x + (r.w - mask.w) / 2, r.y + (r.h - mask.h) / 2, cmd->icon.color);
+            break;
+        }
+        case MU_COMMAND_TEXT:
+            draw_text(cmd->text);
+            break;
+        }
+    }
+}
+
+void Rasterizer::set_glyph(unsigned codepoint, int w, int h, int x, int y, int advance, const uint8_t *alpha) {
+    Glyph g;
+    g.mask = add_mask(w, h, alpha);
+    g.x = x;
+    g.y = y;
+    g.advance = advance;
+    if (codepoint < 128)
+        ascii[codepoint] = g;
+    else
+        glyphs[codepoint] = g;
+}
+
+Rasterizer::Mask Rasterizer::add_mask(int w, int h, const uint8_t *alpha) {
+    Mask mask;
+    mask.offset = atlas.size();
+    mask.w = std::max(w, 0);
+    mask.h = std::max(h, 0);
+    atlas.insert(atlas.end(), alpha, alpha + (size_t)mask.w * mask.h);
+    return mask;
+}
+
+void Rasterizer::bake_icons() {
+    // the shapes `Canvas2DRenderer` strokes, in units of the icon size
+    static const Segment close[] = {{0.3f, 0.3f, 0.7f, 0.7f}, {0.7f, 0.3f, 0.3f, 0.7f}};
+    static const Segment check[] = {{0.2f, 0.55f, 0.35f, 0.7f}, {0.35f, 0.7f, 0.75f, 0.3f}};
+    static const Segment collapsed[] = {{0.45f, 0.35f, 0.6f, 0.5f}, {0.6f, 0.5f, 0.45f, 0.65f}};
+    static const Segment expanded[] = {{0.35f, 0.45f, 0.5f, 0.6f}, {0.5f, 0.6f, 0.65f, 0.45f}};
+    static const struct {
+        int id;
+        const Segment *segments;
+    } shapes[] = {
+        {MU_ICON_CLOSE, close},
+        {MU_ICON_CHECK, check},
+        {MU_ICON_COLLAPSED, collapsed},
+        {MU_ICON_EXPANDED, expanded},
+    };
+    uint8_t alpha[ICON_SIZE * ICON_SIZE];
+    icons[0] = Mask{0, 0, 0};
+    for (const auto &shape : shapes) {
+        stroke_mask(alpha, ICON_SIZE, shape.segments, 2, 1.5f);
+        icons[shape.id] = add_mask(ICON_SIZE, ICON_SIZE, alpha);
+    }
+}
+
+const Rasterizer::Glyph *Rasterizer::glyph(unsigned codepoint) const {
+    if (codepoint < 128)
+        return ascii[codepoint].advance >= 0 ? &ascii[codepoint] : NULL;
+    auto it = glyphs.find(codepoint);
+    return it != glyphs.end() ? &it->second : NULL;
+}
+
+void Rasterizer::fill_rect(mu_Rect rect, mu_Color color) {
+    mu_Rect r = intersect(rect, clip);
+    if (r.w == 0 || r.h == 0 || color.a == 0)
+        return;
+    uint32_t src = opaque_word(color);
+    for (int y = r.y; y < r.y + r.h; ++y) {
+        uint32_t *row = &fb[(size_t)y * fb_width + r.x];
+        if (color.a == 255)
+            fill_span(row, r.w, src);
+        else
+            blend_span(row, r.w, src, color.a);
+    }
+}
+
+void Rasterizer::draw_mask(const Mask &mask, int x, int y, mu_Color color) {
+    mu_Rect r = intersect(mu_rect(x, y, mask.w, mask.h), clip);
+    if (r.w == 0 || r.h == 0 || color.a == 0)
+        return;
+    uint32_t src = opaque_word(color);
+    for (int row = r.y; row < r.y + r.h; ++row) {
+        const uint8_t *alpha = &atlas[mask.offset + (size_t)(row - y) * mask.w + (r.x - x)];
+        blend_mask_span(&fb[(size_t)row * fb_width + r.x], alpha, r.w, src, color.a);
+    }
+}
+
+void Rasterizer::draw_text(const mu_TextCommand &cmd) {
+    int x = cmd.pos.x, y = cmd.pos.y, line_height = cmd.size.y;
+    if (y >= clip.y + clip.h || y + line_height <= clip.y)
+        return;
+    const unsigned char *p = (const unsigned char *)cmd.str;
+    const unsigned char *end = p + strlen(cmd.str);
+    while (p < end && x < clip.x + clip.w) {
+        unsigned cp;
+        p += decode_utf8(p, end, &cp);
+        const Glyph *g = glyph(cp);
+        if (g) {
+            draw_mask(g->mask, x + g->x, y + g->y, cmd.color);
+            x += g->advance;
+            continue;
+        }
+        // a box for glyphs nobody set
+        int advance = std::max(line_height / 2, 3);
+        mu_Rect box = mu_rect(x + 1, y + 2, advance - 2, std::max(line_height - 4, 1));
+        fill_rect(mu_rect(box.x, box.y, box.w, 1), cmd.color);
+        fill_rect(mu_rect(box.x, box.y + box.h - 1, box.w, 1), cmd.color);
+        fill_rect(mu_rect(box.x, box.y, 1, box.h), cmd.color);
+        fill_rect(mu_rect(box.x + box.w - 1, box.y, 1, box.h), cmd.color);
+        x += advance;
+    }
+}
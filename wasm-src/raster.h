@@ -0,0 +1,79 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+extern "C" {
+#include "microui.h"
+}
+
+// Paints the command list of a context into an RGBA framebuffer on the CPU,
+// for snapshot tests, thumbnails, or UIs so rect heavy that one canvas call
+// per command is the bottleneck. Pixels are `mu_Color`s (r, g, b, a bytes),
+// so JS can pass the framebuffer to `putImageData` as is.
+//
+// RECTs are span fills, ICONs are drawn from alpha masks baked at
+// construction and TEXT from a glyph atlas filled with `set_glyph`; glyphs
+// that were never set are drawn as boxes.
+//
+// The spans are blended with SSE2 natively and SIMD128 in WASM builds with
+// `-msimd128`; `-DRASTER_SCALAR` forces the plain loops, which give the same
+// pixels.
+class Rasterizer {
+  public:
+    enum { ICON_SIZE = 16 };
+
+    Rasterizer();
+
+    // the contents are undefined until the next `clear`
+    void resize(int width, int height);
+    void clear(mu_Color color);
+    // paints every command of the last frame
+    void draw(mu_Context *ctx);
+    // same, but only inside `area`, e.g. a damaged rect
+    void draw(mu_Context *ctx, mu_Rect area);
+
+    // `alpha` holds `w * h` coverage bytes, row by row. the mask is placed at
+    // `x, y` off the pen position, which starts at the top left of the line
+    void set_glyph(unsigned codepoint, int w, int h, int x, int y, int advance, const uint8_t *alpha);
+
+    const uint8_t *pixels() const { return (const uint8_t *)fb.data(); }
+    int width() const { return fb_width; }
+    int height() const { return fb_height; }
+
+  private:
+    // a rect of `atlas`, `w` bytes per row
+    struct Mask {
+        size_t offset;
+        int w, h;
+    };
+
+    struct Glyph {
+        Mask mask;
+        int x, y, advance;
+    };
+
+    Mask add_mask(int w, int h, const uint8_t *alpha);
+    void bake_icons();
+    const Glyph *glyph(unsigned codepoint) const;
+
+    void fill_rect(mu_Rect rect, mu_Color color);
+    void draw_mask(const Mask &mask, int x, int y, mu_Color color);
+    void draw_text(const mu_TextCommand &cmd);
+
+    int fb_width = 0;
+    int fb_height = 0;
+    std::vector<uint32_t> fb;
+    // the clip rect of the command being drawn, within the framebuffer
+    mu_Rect clip;
+
+    std::vector<uint8_t> atlas;
+    Mask icons[MU_ICON_MAX];
+    Glyph ascii[128];
+    std::unordered_map<unsigned, Glyph> glyphs;
+};
+
+#endif
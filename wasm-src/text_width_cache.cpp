@@ -0,0 +1,206 @@
+#include "text_width_cache.h"
+
+#include <cmath>
+#include <cstring>
+
+static uint64_t mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return key;
+}
+
+const int *CachedFont::FlatMap::find(uint64_t key) const {
+    if (slots.empty())
+        return NULL;
+    size_t mask = slots.size() - 1;
+    for (size_t i = mix(key) & mask;; i = (i + 1) & mask) {
+        if (slots[i].key == key)
+            return &slots[i].value;
+        if (slots[i].key == 0)
+            return NULL;
+    }
+}
+
+void CachedFont::FlatMap::insert(uint64_t key, int value) {
+    // keep the load factor below 1/2
+    if ((used + 1) * 2 > slots.size()) {
+        std::vector<Slot> old;
+        old.swap(slots);
+        slots.assign(old.empty() ? 64 : old.size() * 2, Slot{0, 0});
+        used = 0;
+        for (const Slot &s : old)
+            if (s.key)
+                insert(s.key, s.value);
+    }
+    size_t mask = slots.size() - 1;
+    size_t i = mix(key) & mask;
+    while (slots[i].key != 0 && slots[i].key != key)
+        i = (i + 1) & mask;
+    if (slots[i].key == 0)
+        ++used;
+    slots[i].key = key;
+    slots[i].value = value;
+}
+
+// decodes one codepoint, malformed bytes decode to themselves
+static int decode_utf8(const unsigned char *p, const unsigned char *end, unsigned *cp) {
+    unsigned c = p[0];
+    int n = c < 0x80 ? 1 : (c & 0xe0) == 0xc0 ? 2 : (c & 0xf0) == 0xe0 ? 3 : (c & 0xf8) == 0xf0 ? 4 : 0;
+    if (n == 0 || p + n > end) {
+        *cp = c;
+        return 1;
+    }
+    unsigned res = n == 1 ? c : c & (0x3f >> (n - 1));
+    for (int i = 1; i < n; ++i) {
+        if ((p[i] & 0xc0) != 0x80) {
+            *cp = c;
+            return 1;
+        }
+        res = (res << 6) | (p[i] & 0x3f);
+    }
+    *cp = res;
+    return n;
+}
+
+static int encode_utf8(unsigned cp, char *buf) {
+    if (cp < 0x80) {
+        buf[0] = cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        buf[0] = 0xc0 | (cp >> 6);
+        buf[1] = 0x80 | (cp & 0x3f);
+        return 2;
+    }
+    if (cp < 0x10000) {
+        buf[0] = 0xe0 | (cp >> 12);
+        buf[1] = 0x80 | ((cp >> 6) & 0x3f);
+        buf[2] = 0x80 | (cp & 0x3f);
+        return 3;
+    }
+    buf[0] = 0xf0 | (cp >> 18);
+    buf[1] = 0x80 | ((cp >> 12) & 0x3f);
+    buf[2] = 0x80 | ((cp >> 6) & 0x3f);
+    buf[3] = 0x80 | (cp & 0x3f);
+    return 4;
+}
+
+int CachedFont::alive = 0;
+
+void CachedFont::reset() {
+    cached_height = -1;
+    for (int &adv : ascii)
+        adv = -1;
+    glyphs = FlatMap();
+}
+
+void CachedFont::set_text_width(int (*text_width)(mu_Font, const char *, int)) {
+    inner_text_width = text_width;
+    reset();
+}
+
+void CachedFont::set_text_height(int (*text_height)(mu_Font)) {
+    inner_text_height = text_height;
+    reset();
+}
+
+int CachedFont::advance(unsigned cp) {
+    if (cp < 128 && ascii[cp] >= 0)
+        return ascii[cp];
+    if (cp >= 128) {
+        if (const int *adv = glyphs.find(cp + 1))
+            return *adv;
+    }
+    // measure a run of copies to keep the sub-pixel part of the advance
+    char glyph[4];
+    char run[4 * SUBPIXEL + 1];
+    int n = encode_utf8(cp, glyph);
+    for (int i = 0; i < SUBPIXEL; ++i)
+        memcpy(run + i * n, glyph, n);
+    run[n * SUBPIXEL] = '\0';
+    int adv = inner_text_width(inner_font, run, n * SUBPIXEL);
+    if (cp < 128)
+        ascii[cp] = adv;
+    else
+        glyphs.insert(cp + 1, adv);
+    return adv;
+}
+
+int CachedFont::width(const char *str, int len) {
+    if (len < 0)
+        len = strlen(str);
+    const unsigned char *p = (const unsigned char *)str;
+    const unsigned char *end = p + len;
+    int sum = 0;
+    unsigned prev = 0;
+    while (p < end) {
+        unsigned cp;
+        p += decode_utf8(p, end, &cp);
+        sum += advance(cp);
+        if (kerning.used && prev) {
+            if (const int *adj = kerning.find(((uint64_t)(prev + 1) << 32) | (cp + 1)))
+                sum += *adj;
+        }
+        prev = cp;
+    }
+    return (sum + SUBPIXEL / 2) / SUBPIXEL;
+}
+
+int CachedFont::height() {
+    if (cached_height < 0)
+        cached_height = inner_text_height(inner_font);
+    return cached_height;
+}
+
+void CachedFont::set_kerning(unsigned a, unsigned b, float adjust) {
+    kerning.insert(((uint64_t)(a + 1) << 32) | (b + 1), (int)lroundf(adjust * SUBPIXEL));
+}
+
+int cached_text_width(mu_Font font, const char *str, int len) {
+    return ((CachedFont *)font)->width(str, len);
+}
+
+int cached_text_height(mu_Font font) {
+    return ((CachedFont *)font)->height();
+}
+
+CachedFont *install_text_width_cache(mu_Context *ctx) {
+    // the same widths are measured again, possibly by changed callbacks
+    mu_text_metrics_changed(ctx);
+    if (ctx->text_width == cached_text_width) {
+        CachedFont *font = (CachedFont *)ctx->style->font;
+        font->reset();
+        return font;
+    }
+    CachedFont *font = new CachedFont(ctx->text_width, ctx->text_height, ctx->style->font);
+    ctx->text_width = cached_text_width;
+    ctx->text_height = cached_text_height;
+    ctx->style->font = font;
+    return font;
+}
+
+void release_text_width_cache(mu_Context *ctx) {
+    if (ctx->text_width != cached_text_width)
+        return;
+    delete (CachedFont *)ctx->style->font;
+    ctx->style->font = NULL;
+    ctx->text_width = NULL;
+    ctx->text_height = NULL;
+}
+
+void set_text_width_callback(mu_Context *ctx, int (*text_width)(mu_Font, const char *, int)) {
+    if (ctx->text_width == cached_text_width)
+        ((CachedFont *)ctx->style->font)->set_text_width(text_width);
+    else
+        ctx->text_width = text_width;
+    mu_text_metrics_changed(ctx);
+}
+
+void set_text_height_callback(mu_Context *ctx, int (*text_height)(mu_Font)) {
+    if (ctx->text_width == cached_text_width)
+        ((CachedFont *)ctx->style->font)->set_text_height(text_height);
+    else
+        ctx->text_height = text_height;
+    mu_text_metrics_changed(ctx);
+}
@@ -0,0 +1,93 @@
+#ifndef TEXT_WIDTH_CACHE_H
+#define TEXT_WIDTH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+extern "C" {
+#include "microui.h"
+}
+
+// A `mu_Font` that remembers glyph advances. It wraps the context's
+// `text_width`/`text_height` callbacks and the font they were given; once a
+// glyph has been measured, string widths are summed from the cached advances
+// without calling back into the wrapped callback.
+//
+// Advances are kept in 1/`SUBPIXEL` px, measured from a run of `SUBPIXEL`
+// copies of the glyph, so summing them does not accumulate the rounding done by
+// integer-returning callbacks.
+class CachedFont {
+  public:
+    enum { SUBPIXEL = 16 };
+
+    CachedFont(int (*text_width)(mu_Font, const char *, int), int (*text_height)(mu_Font), mu_Font font)
+        : inner_text_width(text_width), inner_text_height(text_height), inner_font(font) {
+        reset();
+        ++alive;
+    }
+    ~CachedFont() { --alive; }
+    CachedFont(const CachedFont &) = delete;
+    CachedFont &operator=(const CachedFont &) = delete;
+
+    // fonts not deleted yet, for leak checks
+    static int count() { return alive; }
+
+    int width(const char *str, int len);
+    int height();
+    // `adjust` is in px and is added whenever codepoint `b` follows `a`
+    void set_kerning(unsigned a, unsigned b, float adjust);
+    void reset();
+    // replace the wrapped callbacks, clearing what they measured
+    void set_text_width(int (*text_width)(mu_Font, const char *, int));
+    void set_text_height(int (*text_height)(mu_Font));
+
+    mu_Font font() const { return inner_font; }
+
+  private:
+    struct Slot {
+        uint64_t key;
+        int value;
+    };
+
+    // open addressing map from key to value; key 0 is empty
+    struct FlatMap {
+        std::vector<Slot> slots;
+        size_t used = 0;
+        const int *find(uint64_t key) const;
+        void insert(uint64_t key, int value);
+    };
+
+    int advance(unsigned cp);
+
+    int (*inner_text_width)(mu_Font, const char *, int);
+    int (*inner_text_height)(mu_Font);
+    mu_Font inner_font;
+    int cached_height;
+    // advances of ASCII glyphs, -1 if not measured yet
+    int ascii[128];
+    FlatMap glyphs;
+    FlatMap kerning;
+
+    static int alive;
+};
+
+// callbacks for `mu_Context`, `font` must be a `CachedFont*`
+int cached_text_width(mu_Font font, const char *str, int len);
+int cached_text_height(mu_Font font);
+
+// wraps the current callbacks and style font of `ctx` into a `CachedFont` and
+// makes it the style font. the font belongs to `ctx` until
+// `release_text_width_cache`; installing again on the same context only clears
+// the cached advances.
+CachedFont *install_text_width_cache(mu_Context *ctx);
+
+// frees the font installed on `ctx`, if any, before `mu_deinit`
+void release_text_width_cache(mu_Context *ctx);
+
+// set the callbacks of `ctx`. with the cache installed they replace the ones
+// its font wraps, so it stays installed and is still freed with `ctx`
+void set_text_width_callback(mu_Context *ctx, int (*text_width)(mu_Font, const char *, int));
+void set_text_height_callback(mu_Context *ctx, int (*text_height)(mu_Font));
+
+#endif